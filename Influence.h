@@ -1,94 +1,552 @@
 #ifndef INFLUENCE_H
 #define INFLUENCE_H
 
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
-#include <omp.h>
+#include <string>
+#include <cstdint>
 #include <algorithm>
 
 #include "load_graph.h"
+#include "Intersection.h"
+#include "profile.h"
+#include "numa.h"
 
 using namespace std;
 
-unordered_map<int, double> computeInfluenceScores(
-    const unordered_map<int, vector<Edge>>& subgraph) {
-    
-    // Step 1: Precompute neighbor sets
-    unordered_map<int, unordered_set<int>> neighbors;
-    for (const auto& [node, edges] : subgraph) {
-        unordered_set<int> nbrs;
-        for (const auto& e : edges) {
-            nbrs.insert(e.neighbor);
+// How computeInfluenceScores spreads vertices over OpenMP threads.
+//   Static:      contiguous blocks of vertices (the original behavior)
+//   Dynamic:     small vertex chunks handed out on demand
+//   DegreeAware: vertices binned by estimated work, hub edge lists split
+//                into several tasks, tasks run heaviest-first with OpenMP
+//                task stealing absorbing the tail
+enum class KernelSchedule { Static, Dynamic, DegreeAware };
+
+// Which algorithm computes the scores.
+//   Vertex: every vertex intersects its row with each neighbor's row, so an
+//           edge between two local vertices is intersected from both ends
+//   Edge:    each local-local edge is intersected once by its lower-degree
+//            endpoint and the Jaccard is stored for both directions
+//   MinHash: approximate; Jaccard is estimated from bottom-k sketches of the
+//            neighbor sets in O(k) per edge, exact when the union of the
+//            two sets has at most k elements
+enum class ScoreEngine { Vertex, Edge, MinHash };
+
+// Engine, thread schedule and sketch size of one scoring run. The schedule
+// applies to the per-vertex engine only, and so do `replicas`: per-NUMA-node
+// copies of the scored graph that each thread reads instead of it.
+struct ScoreOptions {
+    ScoreEngine engine = ScoreEngine::Vertex;
+    KernelSchedule schedule = KernelSchedule::DegreeAware;
+    int sketch_size = 64;
+    const NumaReplicas* replicas = nullptr;
+};
+
+// Number of work units the degree-aware schedule aims for
+const int64_t DEGREE_AWARE_UNITS = 1024;
+
+// Per-thread accounting of one computeInfluenceScores call.
+struct ThreadStats {
+    vector<double> busy_seconds;    // time each thread spent scoring
+    vector<long long> tasks;        // work units each thread ran
+
+    // Busiest thread over the mean; 1.0 means perfectly balanced.
+    double imbalance() const {
+        double total = 0.0, peak = 0.0;
+        for (double t : busy_seconds) {
+            total += t;
+            peak = max(peak, t);
+        }
+        return total > 0.0 ? peak * busy_seconds.size() / total : 1.0;
+    }
+};
+
+KernelSchedule parseKernelSchedule(const string& name) {
+    if (name == "static") return KernelSchedule::Static;
+    if (name == "dynamic") return KernelSchedule::Dynamic;
+    return KernelSchedule::DegreeAware;
+}
+
+ScoreEngine parseScoreEngine(const string& name) {
+    if (name == "edge") return ScoreEngine::Edge;
+    if (name == "minhash") return ScoreEngine::MinHash;
+    return ScoreEngine::Vertex;
+}
+
+// Jaccard similarity of two neighbor sets from their sizes and overlap, with
+// the small degree-based fallback for pairs that share no neighbors. The
+// overlap is fractional when it comes from a sketch estimate.
+inline double edgeJaccard(double intersection, int node_degree, int nbr_degree) {
+    double union_size = node_degree + nbr_degree - intersection;
+    double jaccard = union_size > 0 ? intersection / union_size : 0.0;
+
+    // Fallbacck
+    if (jaccard == 0.0){
+        //jaccard = 1.0 / (node_neighbors.size() + nbr_neighbors.size());
+        //jaccard = 1.0 / (1 + std::abs(static_cast<int>(node_neighbors.size()) - static_cast<int>(nbr_neighbors.size())));
+        jaccard = 1.0/(node_degree + nbr_degree);
+        jaccard /= 49;
+    }
+    return jaccard;
+}
+
+// Locates the known neighbors of `nbr` (a local row or a halo row) and its
+// full degree. Returns false if nothing is known about it.
+inline bool neighborRow(const CSRGraph& subgraph, int nbr,
+                        const int*& row, int& len, int& degree) {
+    if (subgraph.isLocal(nbr)) {
+        row = subgraph.row(nbr);
+        len = degree = subgraph.degree(nbr);
+        return true;
+    }
+    if (subgraph.hasHalo()) {
+        // Ghost row holds only the neighbors this partition knows about
+        int g = nbr - subgraph.num_local;
+        row = subgraph.halo_neighbors.data() + subgraph.halo_offsets[g];
+        len = static_cast<int>(subgraph.halo_offsets[g + 1] - subgraph.halo_offsets[g]);
+        degree = subgraph.halo_degrees[g];
+        return true;
+    }
+    return false;
+}
+
+// Weighted Jaccard sum over edges [begin, end) of the row of `node`.
+inline double scoreEdges(const CSRGraph& subgraph, int node, int64_t begin, int64_t end) {
+    const int* node_neighbors = subgraph.row(node);
+    int node_degree = subgraph.degree(node);
+    double score = 0.0;
+    long long comparisons = 0, skipped = 0;
+
+    for (int64_t e = begin; e < end; e++) {
+        int nbr = subgraph.neighbors[e];
+        int weight = subgraph.weights[e];
+
+        const int* nbr_neighbors;
+        int nbr_len, nbr_degree;
+        // Skip if neighbor's neighbors are not known
+        if (!neighborRow(subgraph, nbr, nbr_neighbors, nbr_len, nbr_degree)) {
+            skipped++;
+            continue;
+        }
+
+        // Compute Jaccard similarity
+        int intersection = intersectionCount(node_neighbors, node_degree,
+                                             nbr_neighbors, nbr_len);
+        if (PROFILE_ENABLED) comparisons += intersectionWork(node_degree, nbr_len);
+        score += weight * edgeJaccard(intersection, node_degree, nbr_degree);
+    }
+    profileCount(end - begin - skipped, comparisons, skipped);
+    return score;
+}
+
+namespace influence_detail {
+
+// A run of vertices from the work-sorted order, or one slice of a hub's row.
+struct WorkUnit {
+    int64_t cost;
+    int node;               // hub vertex, or -1 for a vertex run
+    int64_t begin, end;     // edge range of the hub, or range into `order`
+    int slot;               // partial-sum slot of a hub slice
+};
+
+// Merge cost of one edge: both rows are walked once.
+inline int64_t edgeCost(const CSRGraph& subgraph, int node, int64_t e) {
+    int nbr = subgraph.neighbors[e];
+    const int* row;
+    int len, degree;
+    if (!neighborRow(subgraph, nbr, row, len, degree)) return 1;
+    return 1 + subgraph.degree(node) + len;
+}
+
+inline void recordBusy(ThreadStats* stats, double seconds, long long tasks) {
+    profileBusy(seconds);
+    if (!stats) return;
+    int t = omp_get_thread_num();
+    stats->busy_seconds[t] += seconds;
+    stats->tasks[t] += tasks;
+}
+
+void scoreDegreeAware(const CSRGraph& subgraph, vector<double>& scores, ThreadStats* stats,
+                      const NumaReplicas* replicas) {
+    int n = subgraph.num_local;
+
+    // Estimated work per vertex is the sum of its edge merge costs
+    vector<int64_t> cost(n, 0);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int node = 0; node < n; node++) {
+        int64_t c = 0;
+        for (int64_t e = subgraph.offsets[node]; e < subgraph.offsets[node + 1]; e++) {
+            c += edgeCost(subgraph, node, e);
+        }
+        cost[node] = c;
+    }
+    int64_t total = 0;
+    for (int64_t c : cost) total += c;
+
+    // Aim for many more units than threads so stealing can even out the tail.
+    // The unit size depends only on the graph, so hub slices (and with them
+    // the summation order) are the same for every thread count.
+    int64_t target = max<int64_t>(1, total / DEGREE_AWARE_UNITS);
+
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) order[i] = i;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        return cost[a] != cost[b] ? cost[a] > cost[b] : a < b;
+    });
+
+    vector<WorkUnit> units;
+    vector<int> hub_nodes;
+    vector<int> hub_first_slot(1, 0);
+    int slots = 0;
+    int64_t i = 0;
+
+    // Hubs: slice the row into pieces of about `target` work each
+    while (i < n && cost[order[i]] > target) {
+        int node = order[i];
+        int64_t begin = subgraph.offsets[node], acc = 0;
+        for (int64_t e = begin; e < subgraph.offsets[node + 1]; e++) {
+            acc += edgeCost(subgraph, node, e);
+            if (acc >= target || e + 1 == subgraph.offsets[node + 1]) {
+                units.push_back({acc, node, begin, e + 1, slots++});
+                begin = e + 1;
+                acc = 0;
+            }
         }
-        neighbors[node] = nbrs;
+        hub_nodes.push_back(node);
+        hub_first_slot.push_back(slots);
+        i++;
     }
 
-    // Step 2: Prepare keys and values separately for safe OpenMP parallel loop
-    vector<int> nodes;
-    for (const auto& [node, _] : subgraph) {
-        nodes.push_back(node);
+    // Everything else: runs of consecutive vertices in work order
+    while (i < n) {
+        int64_t begin = i, acc = 0;
+        while (i < n && (acc == 0 || acc + cost[order[i]] <= target)) {
+            acc += cost[order[i]];
+            i++;
+        }
+        units.push_back({acc, -1, begin, i, -1});
     }
 
-    unordered_map<int, double> scores;
+    stable_sort(units.begin(), units.end(), [](const WorkUnit& a, const WorkUnit& b) {
+        return a.cost > b.cost;
+    });
+
+    vector<double> partial(slots, 0.0);
 
-    // Step 3: Parallel score computation
     #pragma omp parallel
+    #pragma omp single
     {
-        unordered_map<int, double> local_scores;
+        for (size_t u = 0; u < units.size(); u++) {
+            #pragma omp task firstprivate(u)
+            {
+                double start = omp_get_wtime();
+                const WorkUnit& unit = units[u];
+                const CSRGraph& graph = replicas ? replicas->forThread() : subgraph;
+                if (unit.node >= 0) {
+                    partial[unit.slot] = scoreEdges(graph, unit.node, unit.begin, unit.end);
+                } else {
+                    for (int64_t k = unit.begin; k < unit.end; k++) {
+                        int node = order[k];
+                        scores[node] = scoreEdges(graph, node, graph.offsets[node],
+                                                  graph.offsets[node + 1]);
+                    }
+                }
+                recordBusy(stats, omp_get_wtime() - start, 1);
+            }
+        }
+    }
 
-        #pragma omp for nowait
-        for (int i = 0; i < nodes.size(); i++) {
-            int node = nodes[i];
-            const auto& edges = subgraph.at(node);
+    // Reduce hub slices in slice order so the result is reproducible
+    for (size_t h = 0; h < hub_nodes.size(); h++) {
+        double score = 0.0;
+        for (int s = hub_first_slot[h]; s < hub_first_slot[h + 1]; s++) {
+            score += partial[s];
+        }
+        scores[hub_nodes[h]] = score;
+    }
+}
 
-            double score = 0.0;
+}
 
-            const auto& node_neighbors = neighbors[node];
+// Returns one score per local vertex of the subgraph (indexed by local ID).
+// Edges to ghost vertices are scored when the subgraph carries a halo and
+// skipped otherwise. When `stats` is given it receives per-thread busy time.
+// With `replicas`, each thread reads its NUMA node's copy of the subgraph.
+vector<double> computeInfluenceScores(const CSRGraph& subgraph,
+                                      KernelSchedule schedule = KernelSchedule::DegreeAware,
+                                      ThreadStats* stats = nullptr,
+                                      const NumaReplicas* replicas = nullptr) {
+    int n = subgraph.num_local;
+    vector<double> scores(n, 0.0);
 
-            for (const auto& edge : edges) {
-                int nbr = edge.neighbor;
-                int weight = edge.weight;
+    if (stats) {
+        stats->busy_seconds.assign(omp_get_max_threads(), 0.0);
+        stats->tasks.assign(omp_get_max_threads(), 0);
+    }
 
-                // Skip if neighbor's neighbors are not known
-                if (!neighbors.count(nbr)) continue;
+    if (schedule == KernelSchedule::DegreeAware) {
+        influence_detail::scoreDegreeAware(subgraph, scores, stats, replicas);
+        return scores;
+    }
 
-                const auto& nbr_neighbors = neighbors[nbr];
+    // Rows are already neighbor sets, so each vertex is scored straight from CSR
+    #pragma omp parallel
+    {
+        double start = omp_get_wtime();
+        long long count = 0;
+        const CSRGraph& graph = replicas ? replicas->forThread() : subgraph;
 
-                // Compute Jaccard similarity
-                int intersection = 0;
-                for (int u : node_neighbors) {
-                    if (nbr_neighbors.count(u)) {
-                        intersection++;
+        if (schedule == KernelSchedule::Static) {
+            #pragma omp for schedule(static) nowait
+            for (int node = 0; node < n; node++) {
+                scores[node] = scoreEdges(graph, node, graph.offsets[node], graph.offsets[node + 1]);
+                count++;
+            }
+        } else {
+            #pragma omp for schedule(dynamic, 64) nowait
+            for (int node = 0; node < n; node++) {
+                scores[node] = scoreEdges(graph, node, graph.offsets[node], graph.offsets[node + 1]);
+                count++;
+            }
+        }
+
+        influence_detail::recordBusy(stats, omp_get_wtime() - start, count);
+    }
+
+    return scores;
+}
+
+// Same scores as computeInfluenceScores, but every edge between two local
+// vertices is intersected only once. Vertices are ranked by (degree, ID) and
+// the lower-ranked endpoint owns the edge: it computes the intersection,
+// binary-searches the reverse slot in the other row and writes the Jaccard
+// into both slots. Each slot has a single writer, so no atomics are needed.
+// Each row is then summed in its own edge order, so for any thread count
+// the scores are bit-identical to the per-vertex path under the static and
+// dynamic schedules. The degree-aware schedule sums hub rows as slice
+// partials, so there hub scores can differ in the last bits; other rows
+// still match exactly.
+//
+// A block merge costs O(du + dv), which is O(min(du, dv)) below
+// GALLOP_RATIO; galloping costs O(min(du, dv) * log(max(du, dv) / min(du, dv))).
+// Summed over all edges that is O(m * sqrt(m) * log n).
+vector<double> computeInfluenceScoresEdgeOnce(const CSRGraph& subgraph,
+                                              ThreadStats* stats = nullptr) {
+    int n = subgraph.num_local;
+    vector<double> scores(n, 0.0);
+    vector<double> jaccard(subgraph.neighbors.size(), 0.0);
+
+    if (stats) {
+        stats->busy_seconds.assign(omp_get_max_threads(), 0.0);
+        stats->tasks.assign(omp_get_max_threads(), 0);
+    }
+
+    auto before = [&](int a, int b) {
+        int da = subgraph.degree(a), db = subgraph.degree(b);
+        return da != db ? da < db : a < b;
+    };
+
+    #pragma omp parallel
+    {
+        double start = omp_get_wtime();
+        long long count = 0, comparisons = 0, skipped = 0;
+
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (int node = 0; node < n; node++) {
+            const int* node_neighbors = subgraph.row(node);
+            int node_degree = subgraph.degree(node);
+
+            for (int64_t e = subgraph.offsets[node]; e < subgraph.offsets[node + 1]; e++) {
+                int nbr = subgraph.neighbors[e];
+
+                // Owned by the other endpoint, unless it has no reverse edge
+                int64_t reverse = -1;
+                if (subgraph.isLocal(nbr)) {
+                    const int* nbr_row = subgraph.row(nbr);
+                    const int* it = lower_bound(nbr_row, nbr_row + subgraph.degree(nbr), node);
+                    if (it != nbr_row + subgraph.degree(nbr) && *it == node) {
+                        reverse = subgraph.offsets[nbr] + (it - nbr_row);
+                        if (before(nbr, node)) continue;
                     }
                 }
 
-                int union_size = node_neighbors.size() + nbr_neighbors.size() - intersection;
-                double jaccard = union_size > 0 ? static_cast<double>(intersection) / union_size : 0.0;
-
-                // Fallbacck
-                if (jaccard == 0.0){
-                    //jaccard = 1.0 / (node_neighbors.size() + nbr_neighbors.size());
-                    //jaccard = 1.0 / (1 + std::abs(static_cast<int>(node_neighbors.size()) - static_cast<int>(nbr_neighbors.size())));
-                    jaccard = 1.0/(node_neighbors.size() + nbr_neighbors.size());
-                    jaccard /= 49;
+                const int* nbr_neighbors;
+                int nbr_len, nbr_degree;
+                if (!neighborRow(subgraph, nbr, nbr_neighbors, nbr_len, nbr_degree)) {
+                    skipped++;
+                    continue;
                 }
-                score += weight * jaccard;
+
+                int intersection = intersectionCount(node_neighbors, node_degree,
+                                                     nbr_neighbors, nbr_len);
+                if (PROFILE_ENABLED) comparisons += intersectionWork(node_degree, nbr_len);
+                jaccard[e] = edgeJaccard(intersection, node_degree, nbr_degree);
+                if (reverse >= 0) jaccard[reverse] = jaccard[e];
+                count++;
             }
+        }
+        profileCount(count, comparisons, skipped);
 
-            local_scores[node] = score;
+        // Every slot is written before any row is summed
+        #pragma omp barrier
+
+        #pragma omp for schedule(static) nowait
+        for (int node = 0; node < n; node++) {
+            double score = 0.0;
+            for (int64_t e = subgraph.offsets[node]; e < subgraph.offsets[node + 1]; e++) {
+                score += subgraph.weights[e] * jaccard[e];
+            }
+            scores[node] = score;
         }
 
-        // Step 4: Merge local scores into global map
-        #pragma omp critical
-        {
-            for (const auto& [node, score] : local_scores) {
-                scores[node] = score;
+        influence_detail::recordBusy(stats, omp_get_wtime() - start, count);
+    }
+
+    return scores;
+}
+
+namespace influence_detail {
+
+// 64-bit finalizer of splitmix64; sketches hash METIS IDs so a vertex gets
+// the same value in every partition.
+inline uint64_t sketchHash(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Bottom-k sketches: for every vertex, the k smallest neighbor hashes in
+// ascending order (fewer when the row is shorter than k), stored like CSR.
+struct Sketches {
+    int k = 0;
+    vector<int> sizes;          // sketch length per vertex, -1 if row unknown
+    vector<int64_t> offsets;
+    vector<uint64_t> hashes;
+
+    const uint64_t* of(int v) const { return hashes.data() + offsets[v]; }
+};
+
+Sketches buildSketches(const CSRGraph& subgraph, int k) {
+    Sketches sk;
+    sk.k = k;
+    int nv = subgraph.numVertices();
+    sk.sizes.assign(nv, -1);
+    sk.offsets.assign(nv + 1, 0);
+    for (int v = 0; v < nv; v++) {
+        const int* row;
+        int len, degree;
+        if (neighborRow(subgraph, v, row, len, degree)) sk.sizes[v] = min(len, k);
+        sk.offsets[v + 1] = sk.offsets[v] + max(sk.sizes[v], 0);
+    }
+    sk.hashes.resize(sk.offsets[nv]);
+
+    #pragma omp parallel
+    {
+        vector<uint64_t> buf;
+        #pragma omp for schedule(dynamic, 256)
+        for (int v = 0; v < nv; v++) {
+            if (sk.sizes[v] < 0) continue;
+            const int* row = nullptr;
+            int len = 0, degree = 0;
+            neighborRow(subgraph, v, row, len, degree);
+
+            buf.resize(len);
+            for (int i = 0; i < len; i++) {
+                buf[i] = sketchHash(static_cast<uint64_t>(subgraph.vertex_ids[row[i]]));
+            }
+            int keep = sk.sizes[v];
+            partial_sort(buf.begin(), buf.begin() + keep, buf.end());
+            copy(buf.begin(), buf.begin() + keep, sk.hashes.begin() + sk.offsets[v]);
+        }
+    }
+    return sk;
+}
+
+// Jaccard estimate of two sets from their bottom-k sketches: the share of
+// the k smallest hashes of the union that appear in both sketches.
+inline double sketchJaccard(const uint64_t* a, int na, const uint64_t* b, int nb, int k) {
+    int i = 0, j = 0, taken = 0, both = 0;
+    while (taken < k && (i < na || j < nb)) {
+        if (j == nb || (i < na && a[i] < b[j])) {
+            i++;
+        } else if (i == na || b[j] < a[i]) {
+            j++;
+        } else {
+            both++;
+            i++;
+            j++;
+        }
+        taken++;
+    }
+    return taken > 0 ? static_cast<double>(both) / taken : 0.0;
+}
+
+}
+
+// Approximate scores from bottom-k sketches built in one parallel pass over
+// the rows. For each edge the Jaccard of the two known rows is estimated from
+// the sketches, turned back into an overlap estimate from the row sizes, and
+// fed through edgeJaccard, so the full-degree union and the zero-overlap
+// fallback are applied exactly as in the exact engines.
+vector<double> computeInfluenceScoresMinHash(const CSRGraph& subgraph, int sketch_size,
+                                             ThreadStats* stats = nullptr) {
+    int n = subgraph.num_local;
+    vector<double> scores(n, 0.0);
+
+    if (stats) {
+        stats->busy_seconds.assign(omp_get_max_threads(), 0.0);
+        stats->tasks.assign(omp_get_max_threads(), 0);
+    }
+
+    influence_detail::Sketches sk = influence_detail::buildSketches(subgraph, max(1, sketch_size));
+
+    #pragma omp parallel
+    {
+        double start = omp_get_wtime();
+        long long count = 0, estimates = 0, comparisons = 0, skipped = 0;
+
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (int node = 0; node < n; node++) {
+            int node_degree = subgraph.degree(node);
+            double score = 0.0;
+
+            for (int64_t e = subgraph.offsets[node]; e < subgraph.offsets[node + 1]; e++) {
+                int nbr = subgraph.neighbors[e];
+                int weight = subgraph.weights[e];
+
+                const int* nbr_neighbors;
+                int nbr_len, nbr_degree;
+                if (!neighborRow(subgraph, nbr, nbr_neighbors, nbr_len, nbr_degree)) {
+                    skipped++;
+                    continue;
+                }
+
+                estimates++;
+                comparisons += min(sk.k, sk.sizes[node] + sk.sizes[nbr]);
+                double j = influence_detail::sketchJaccard(sk.of(node), sk.sizes[node],
+                                                           sk.of(nbr), sk.sizes[nbr], sk.k);
+                double intersection = j * (node_degree + nbr_len) / (1.0 + j);
+                score += weight * edgeJaccard(intersection, node_degree, nbr_degree);
             }
+            scores[node] = score;
+            count++;
         }
+        profileCount(estimates, comparisons, skipped);
+
+        influence_detail::recordBusy(stats, omp_get_wtime() - start, count);
     }
 
     return scores;
 }
 
+// Scores `subgraph` with the engine, schedule and sketch size in `options`.
+vector<double> computeInfluenceScores(const CSRGraph& subgraph, const ScoreOptions& options,
+                                      ThreadStats* stats = nullptr) {
+    if (options.engine == ScoreEngine::Edge) return computeInfluenceScoresEdgeOnce(subgraph, stats);
+    if (options.engine == ScoreEngine::MinHash) {
+        return computeInfluenceScoresMinHash(subgraph, options.sketch_size, stats);
+    }
+    return computeInfluenceScores(subgraph, options.schedule, stats, options.replicas);
+}
+
 #endif
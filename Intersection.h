@@ -0,0 +1,177 @@
+#ifndef INTERSECTION_H
+#define INTERSECTION_H
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INTERSECT_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Intersection-count kernels for ascending, duplicate-free neighbor lists.
+// intersectionCount() picks galloping search for skewed degree pairs and the
+// widest SIMD block kernel the CPU supports otherwise; the individual kernels
+// are exposed so they can be checked against each other.
+
+// Degree ratio above which the short list is binary-searched into the long one
+const int GALLOP_RATIO = 32;
+
+inline int intersectScalar(const int* a, int na, const int* b, int nb) {
+    int i = 0, j = 0, count = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+// Exponential then binary search of each element of the short list `a`
+// in the remaining part of the long list `b`.
+inline int intersectGallop(const int* a, int na, const int* b, int nb) {
+    int count = 0;
+    int lo = 0;
+    for (int i = 0; i < na && lo < nb; i++) {
+        int target = a[i];
+        if (b[lo] < target) {
+            int step = 1;
+            int hi = lo + 1;
+            while (hi < nb && b[hi] < target) {
+                lo = hi;
+                step <<= 1;
+                hi = lo + step;
+            }
+            hi = min(hi + 1, nb);
+            lo = static_cast<int>(lower_bound(b + lo, b + hi, target) - b);
+        }
+        if (lo < nb && b[lo] == target) {
+            count++;
+            lo++;
+        }
+    }
+    return count;
+}
+
+#ifdef INTERSECT_X86
+
+// Block kernels compare a W-wide block of `a` against every rotation of a
+// W-wide block of `b`, then advance whichever block ends lower. Lists are
+// duplicate-free, so each element of `a` matches at most once per block pair.
+
+__attribute__((target("sse4.2")))
+inline int intersectSSE(const int* a, int na, const int* b, int nb) {
+    int i = 0, j = 0, count = 0;
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+        int a_max = a[i + 3], b_max = b[j + 3];
+        if (a_max <= b_max) i += 4;
+        if (b_max <= a_max) j += 4;
+    }
+    return count + intersectScalar(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx2")))
+inline int intersectAVX2(const int* a, int na, const int* b, int nb) {
+    const __m256i rot = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    int i = 0, j = 0, count = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        __m256i m = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; r++) {
+            vb = _mm256_permutevar8x32_epi32(vb, rot);
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, vb));
+        }
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        int a_max = a[i + 7], b_max = b[j + 7];
+        if (a_max <= b_max) i += 8;
+        if (b_max <= a_max) j += 8;
+    }
+    return count + intersectSSE(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx512f")))
+inline int intersectAVX512(const int* a, int na, const int* b, int nb) {
+    const __m512i rot = _mm512_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0);
+    int i = 0, j = 0, count = 0;
+    while (i + 16 <= na && j + 16 <= nb) {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + j);
+        __mmask16 m = _mm512_cmpeq_epi32_mask(va, vb);
+        for (int r = 1; r < 16; r++) {
+            vb = _mm512_maskz_permutexvar_epi32(0xFFFF, rot, vb);
+            m |= _mm512_cmpeq_epi32_mask(va, vb);
+        }
+        count += __builtin_popcount(m);
+        int a_max = a[i + 15], b_max = b[j + 15];
+        if (a_max <= b_max) i += 16;
+        if (b_max <= a_max) j += 16;
+    }
+    return count + intersectAVX2(a + i, na - i, b + j, nb - j);
+}
+
+#endif
+
+typedef int (*IntersectKernel)(const int*, int, const int*, int);
+
+// Resolves the block kernel once from the running CPU's feature flags.
+inline IntersectKernel selectIntersectKernel() {
+#ifdef INTERSECT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return intersectAVX512;
+    if (__builtin_cpu_supports("avx2")) return intersectAVX2;
+    if (__builtin_cpu_supports("sse4.2")) return intersectSSE;
+#endif
+    return intersectScalar;
+}
+
+inline const char* intersectKernelName() {
+#ifdef INTERSECT_X86
+    IntersectKernel k = selectIntersectKernel();
+    if (k == intersectAVX512) return "avx512";
+    if (k == intersectAVX2) return "avx2";
+    if (k == intersectSSE) return "sse4.2";
+#endif
+    return "scalar";
+}
+
+inline int intersectionCount(const int* a, int na, const int* b, int nb) {
+    static const IntersectKernel kernel = selectIntersectKernel();
+    if (na > nb) {
+        swap(a, b);
+        swap(na, nb);
+    }
+    if (na == 0 || a[na - 1] < b[0] || b[nb - 1] < a[0]) return 0;
+    if (nb / na >= GALLOP_RATIO) return intersectGallop(a, na, b, nb);
+    return kernel(a, na, b, nb);
+}
+
+// Upper bound on the elements intersectionCount() compares for lists of
+// these lengths: both lists for a block merge, about two probes per doubling
+// step for each element of the short list when galloping. For instrumentation.
+inline long long intersectionWork(int na, int nb) {
+    if (na > nb) swap(na, nb);
+    if (na == 0) return 0;
+    if (nb / na < GALLOP_RATIO) return static_cast<long long>(na) + nb;
+    int steps = 1;
+    for (int ratio = nb / na; ratio > 1; ratio >>= 1) steps++;
+    return 2LL * na * steps;
+}
+
+#endif
@@ -4,32 +4,139 @@
 #include <queue>
 #include <utility>
 
-vector<pair<int, double>> getTopKInfluencers(const unordered_map<int, double>& scores, int k) {
-    // Min-heap to maintain top-k (smallest score at top)
-    auto cmp = [](const pair<int, double>& a, const pair<int, double>& b) {
-        return a.second > b.second; // min-heap based on score
+#include "load_graph.h"
+
+// Selection order of every top-K here: higher score first, ties broken by the
+// lower node ID, so the result does not depend on hash order or thread count.
+inline bool rankedBefore(const pair<int, double>& a, const pair<int, double>& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+}
+
+// Best `Capacity` pairs seen so far in a sorted fixed-size array; for the
+// small compile-time K of the drivers this stays in a few cache lines and
+// insertion is a short shift.
+template <int Capacity>
+struct FixedTopK {
+    pair<int, double> items[Capacity];
+    int count = 0;
+
+    void offer(int id, double score) {
+        pair<int, double> item(id, score);
+        if (count == Capacity && !rankedBefore(item, items[Capacity - 1])) return;
+        int pos = count < Capacity ? count++ : Capacity - 1;
+        while (pos > 0 && rankedBefore(item, items[pos - 1])) {
+            items[pos] = items[pos - 1];
+            pos--;
+        }
+        items[pos] = item;
+    }
+
+    void merge(const FixedTopK& other) {
+        for (int i = 0; i < other.count; ++i) offer(other.items[i].first, other.items[i].second);
+    }
+
+    vector<pair<int, double>> result() const {
+        return vector<pair<int, double>>(items, items + count);
+    }
+};
+
+// Same for a k only known at run time, as a bounded min-heap.
+struct HeapTopK {
+    struct Worse {
+        bool operator()(const pair<int, double>& a, const pair<int, double>& b) const {
+            return rankedBefore(a, b);
+        }
     };
-    priority_queue<pair<int, double>, vector<pair<int, double>>, decltype(cmp)> minHeap(cmp);
 
-    for (const auto& [node, score] : scores) {
-        if (minHeap.size() < k) {
-            minHeap.emplace(node, score);
-        } else if (score > minHeap.top().second) {
-            minHeap.pop();
-            minHeap.emplace(node, score);
+    size_t k = 0;
+    priority_queue<pair<int, double>, vector<pair<int, double>>, Worse> heap;  // worst on top
+
+    explicit HeapTopK(int capacity = 0) : k(capacity > 0 ? capacity : 0) {}
+
+    void offer(int id, double score) {
+        if (k == 0) return;
+        pair<int, double> item(id, score);
+        if (heap.size() < k) {
+            heap.push(item);
+        } else if (rankedBefore(item, heap.top())) {
+            heap.pop();
+            heap.push(item);
         }
     }
 
-    // Move to vector and sort in descending order
-    vector<pair<int, double>> topK;
-    while (!minHeap.empty()) {
-        topK.push_back(minHeap.top());
-        minHeap.pop();
+    void merge(HeapTopK other) {
+        while (!other.heap.empty()) {
+            offer(other.heap.top().first, other.heap.top().second);
+            other.heap.pop();
+        }
     }
 
-    reverse(topK.begin(), topK.end()); // Highest score first
-    return topK;
+    vector<pair<int, double>> result() const {
+        auto copy = heap;
+        vector<pair<int, double>> topK;
+        while (!copy.empty()) {
+            topK.push_back(copy.top());
+            copy.pop();
+        }
+        reverse(topK.begin(), topK.end()); // Highest score first
+        return topK;
+    }
+};
+
+// Top-K of a dense score array: every thread selects from its share of the
+// indices into its own buffer, and the buffers are merged at the end.
+// `id_of(i)` gives the node ID reported for index i.
+template <class Selector, class IdOf>
+vector<pair<int, double>> selectTopK(const vector<double>& scores, const Selector& empty, IdOf id_of) {
+    Selector best = empty;
+    int n = static_cast<int>(scores.size());
+
+    #pragma omp parallel
+    {
+        Selector mine = empty;
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n; ++i) {
+            mine.offer(id_of(i), scores[i]);
+        }
+        #pragma omp critical(topk_merge)
+        best.merge(mine);
+    }
+    return best.result();
 }
 
+// Runtime k that takes the compile-time selector when k is the default KC.
+template <int KC, class IdOf>
+vector<pair<int, double>> selectTopK(const vector<double>& scores, int k, IdOf id_of) {
+    if (k == KC) return selectTopK(scores, FixedTopK<KC>(), id_of);
+    return selectTopK(scores, HeapTopK(k), id_of);
+}
+
+vector<pair<int, double>> getTopKInfluencers(const unordered_map<int, double>& scores, int k) {
+    HeapTopK best(k);
+    for (const auto& [node, score] : scores) {
+        best.offer(node, score);
+    }
+    return best.result();
+}
+
+// Dense variant for scores indexed by local ID; returns METIS node IDs.
+vector<pair<int, double>> getTopKInfluencers(const CSRGraph& subgraph,
+                                             const vector<double>& scores, int k) {
+    return selectTopK(scores, HeapTopK(k), [&](int v) { return subgraph.vertex_ids[v]; });
+}
+
+// Same with K fixed at compile time, using the sorted-array selector.
+template <int KC>
+vector<pair<int, double>> getTopKInfluencers(const CSRGraph& subgraph,
+                                             const vector<double>& scores) {
+    return selectTopK(scores, FixedTopK<KC>(), [&](int v) { return subgraph.vertex_ids[v]; });
+}
+
+// Runtime k that takes the compile-time selector when k is the default KC.
+template <int KC>
+vector<pair<int, double>> getTopKInfluencers(const CSRGraph& subgraph,
+                                             const vector<double>& scores, int k) {
+    return selectTopK<KC>(scores, k, [&](int v) { return subgraph.vertex_ids[v]; });
+}
 
-#endif
\ No newline at end of file
+#endif
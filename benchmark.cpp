@@ -0,0 +1,337 @@
+// g++ -std=c++17 -O2 -fopenmp -o benchmark benchmark.cpp
+// ./benchmark [--model rmat|chunglu] [--scale S] [--edge-factor F] [--seed S]
+//             [--unweighted] [--parts N] [--threads 1,2,4] [--reps R]
+//             [--omp-schedule static|dynamic|degree] [--layout plain|compressed]
+//             [--reorder none|degree|rcm] [--dir DIR] [--json FILE] [--label L]
+//
+// Generates a synthetic power-law layer, writes it as DIR/graphs/synthetic.graph
+// and DIR/gparts/synthetic.graph.part.N, and times each pipeline stage on it
+// for every thread count: loadGraph, attachHalos, computeInfluenceScores,
+// getTopKInfluencers and their total over one layer (with --layout compressed,
+// compressGraph and the compressed kernel). The total re-runs the stages in
+// the serial driver's order; it does not time serialVersion itself. Each
+// stage keeps its best time over --reps runs. Results go to stdout and, as
+// JSON, to --json so runs from different commits can be compared. With
+// --reorder the partitions are relabeled after attachHalos, and the kernel is
+// also timed on the original order in the same run, together with the model
+// cache miss rate of both orders (estimateRowMissRate).
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdlib>
+#include <ctime>
+#include <sys/resource.h>
+#include "load_graph.h"
+#include "Influence.h"
+#include "Top-k.h"
+#include "compressed_graph.h"
+#include "synthetic_graph.h"
+#include "reorder.h"
+
+using namespace std;
+
+const int K = 10;
+
+struct StageTimes {
+    double load = 1e300, halo = 1e300, compress = 1e300, score = 1e300, topk = 1e300, layer_total = 1e300;
+    double bytes_per_edge = 0.0;    // adjacency held while scoring
+    // With --reorder: relabeling time, kernel time on the original order and
+    // the estimated row miss rate before and after
+    double reorder = 1e300, score_original = 1e300;
+    double miss_before = 0.0, miss_after = 0.0;
+};
+
+// Peak resident set size of this process so far, in kilobytes
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+vector<int> parseThreadList(const string& list) {
+    vector<int> threads;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ',')) {
+        int t = atoi(item.c_str());
+        if (t > 0) threads.push_back(t);
+    }
+    return threads;
+}
+
+// Runs the stages once at the current thread count and lowers `best` where
+// faster. Returns the sum of all scores so runs can be checked against each
+// other.
+double runStages(const string& graph_path, const string& part_path, int num_parts, bool weighted,
+                 const ScoreOptions& options, AdjacencyLayout layout, VertexOrder vertex_order,
+                 StageTimes& best) {
+    double start = omp_get_wtime();
+    vector<CSRGraph> subgraphs(num_parts);
+    loadGraph(graph_path, part_path, subgraphs, weighted);
+    double load_end = omp_get_wtime();
+    attachHalos(subgraphs);
+    double halo_end = omp_get_wtime();
+
+    // Kernel on the original order first, then relabel; neither counts
+    // towards the layer total except the relabeling
+    double original_seconds = 0.0, reorder_seconds = 0.0;
+    if (vertex_order != VertexOrder::None) {
+        double miss_before = 0.0, miss_after = 0.0;
+        int64_t total = 0;
+        for (int part = 0; part < num_parts; ++part) {
+            int64_t part_edges = subgraphs[part].numEdges();
+            miss_before += estimateRowMissRate(subgraphs[part]) * part_edges;
+            double kernel_start = omp_get_wtime();
+            computeInfluenceScores(subgraphs[part], options);
+            double reorder_start = omp_get_wtime();
+            reorderGraph(subgraphs[part], vertex_order);
+            double reorder_end = omp_get_wtime();
+            original_seconds += reorder_start - kernel_start;
+            reorder_seconds += reorder_end - reorder_start;
+            miss_after += estimateRowMissRate(subgraphs[part]) * part_edges;
+            total += part_edges;
+        }
+        best.score_original = min(best.score_original, original_seconds);
+        best.reorder = min(best.reorder, reorder_seconds);
+        best.miss_before = total > 0 ? miss_before / total : 0.0;
+        best.miss_after = total > 0 ? miss_after / total : 0.0;
+    }
+    double reorder_end = omp_get_wtime();
+
+    // The compressed layout replaces each CSR before scoring
+    vector<CompressedGraph> packed;
+    size_t bytes = 0;
+    int64_t edges = 0;
+    if (layout == AdjacencyLayout::Compressed) {
+        packed.resize(num_parts);
+        for (int part = 0; part < num_parts; ++part) {
+            edges += subgraphs[part].numEdges();
+            packed[part] = compressGraph(subgraphs[part]);
+            bytes += packed[part].bytes();
+            subgraphs[part].neighbors = vector<int>();
+            subgraphs[part].weights = vector<int>();
+            subgraphs[part].halo_neighbors = vector<int>();
+        }
+    } else {
+        for (const auto& g : subgraphs) {
+            edges += g.numEdges();
+            bytes += adjacencyBytes(g);
+        }
+    }
+    double compress_end = omp_get_wtime();
+
+    vector<vector<double>> scores(num_parts);
+    for (int part = 0; part < num_parts; ++part) {
+        scores[part] = packed.empty() ? computeInfluenceScores(subgraphs[part], options)
+                                      : computeInfluenceScoresCompressed(packed[part]);
+    }
+    double score_end = omp_get_wtime();
+
+    // The serial driver keeps each node's best score across partitions
+    unordered_map<int, double> merged;
+    for (int part = 0; part < num_parts; ++part) {
+        for (int v = 0; v < subgraphs[part].num_local; ++v) {
+            double& s = merged[subgraphs[part].vertex_ids[v]];
+            s = max(s, scores[part][v]);
+        }
+    }
+    auto globalTopK = getTopKInfluencers(merged, K);
+    double end = omp_get_wtime();
+
+    // Dense per-partition selection on its own, as run_mpi does it
+    double topk_start = omp_get_wtime();
+    HeapTopK candidates(K);
+    for (int part = 0; part < num_parts; ++part) {
+        for (const auto& [node, score] : getTopKInfluencers<K>(subgraphs[part], scores[part])) {
+            candidates.offer(node, score);
+        }
+    }
+    auto denseTopK = candidates.result();
+    double topk_end = omp_get_wtime();
+    if (denseTopK != globalTopK) {
+        cerr << "Warning: Dense and merged top-" << K << " differ" << endl;
+    }
+
+    best.load = min(best.load, load_end - start);
+    best.halo = min(best.halo, halo_end - load_end);
+    best.compress = min(best.compress, compress_end - reorder_end);
+    best.score = min(best.score, score_end - compress_end);
+    best.bytes_per_edge = edges > 0 ? static_cast<double>(bytes) / edges : 0.0;
+    best.topk = min(best.topk, topk_end - topk_start);
+    best.layer_total = min(best.layer_total, end - start - original_seconds);
+
+    double checksum = 0.0;
+    for (const auto& part_scores : scores) {
+        for (double s : part_scores) checksum += s;
+    }
+    return checksum;
+}
+
+int main(int argc, char** argv) {
+    SyntheticOptions gen;
+    bool weighted = true;
+    int num_parts = NUM_PARTS;
+    int reps = 3;
+    ScoreOptions options;
+    AdjacencyLayout layout = AdjacencyLayout::Plain;
+    VertexOrder vertex_order = VertexOrder::None;
+    string dir = "bench", json_path, label;
+    vector<int> threads;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--model" && i + 1 < argc) {
+            gen.model = parseGraphModel(argv[++i]);
+        } else if (arg == "--scale" && i + 1 < argc) {
+            gen.scale = atoi(argv[++i]);
+        } else if (arg == "--edge-factor" && i + 1 < argc) {
+            gen.edge_factor = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            gen.seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (arg == "--unweighted") {
+            weighted = false;
+        } else if (arg == "--parts" && i + 1 < argc) {
+            num_parts = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = parseThreadList(argv[++i]);
+        } else if (arg == "--reps" && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (arg == "--omp-schedule" && i + 1 < argc) {
+            options.schedule = parseKernelSchedule(argv[++i]);
+        } else if (arg == "--layout" && i + 1 < argc) {
+            layout = parseAdjacencyLayout(argv[++i]);
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertex_order = parseVertexOrder(argv[++i]);
+        } else if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--label" && i + 1 < argc) {
+            label = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [--model rmat|chunglu] [--scale S] [--edge-factor F]"
+                 << " [--seed S] [--unweighted] [--parts N] [--threads 1,2,4] [--reps R]"
+                 << " [--omp-schedule static|dynamic|degree] [--layout plain|compressed]"
+                 << " [--reorder none|degree|rcm] [--dir DIR] [--json FILE] [--label L]" << endl;
+            return 1;
+        }
+    }
+    if (num_parts < 1 || reps < 1 || gen.scale < 1 || gen.scale > 30 || gen.edge_factor < 1) {
+        cerr << "--parts, --reps and --edge-factor must be at least 1, --scale between 1 and 30" << endl;
+        return 1;
+    }
+    if (vertex_order != VertexOrder::None && layout != AdjacencyLayout::Plain) {
+        cerr << "--reorder compares kernels on the plain layout" << endl;
+        return 1;
+    }
+    if (threads.empty()) {
+        for (int t = 1; t < omp_get_max_threads(); t *= 2) threads.push_back(t);
+        threads.push_back(omp_get_max_threads());
+    }
+    if (json_path.empty()) json_path = dir + "/benchmark.json";
+
+    // Generate and write the layer
+    filesystem::create_directories(dir + "/graphs");
+    filesystem::create_directories(dir + "/gparts");
+    string graph_path = dir + "/graphs/synthetic.graph";
+    string part_path = dir + "/gparts/synthetic.graph.part." + to_string(num_parts);
+
+    double gen_start = omp_get_wtime();
+    SyntheticGraph synthetic = generateSyntheticGraph(gen);
+    double gen_seconds = omp_get_wtime() - gen_start;
+    if (!writeMetisGraph(graph_path, synthetic, weighted) ||
+        !writePartitionFile(part_path, synthetic, num_parts)) {
+        return 1;
+    }
+    int64_t edges = synthetic.numEdges();
+    int max_degree = 0;
+    for (int v = 0; v < synthetic.num_nodes; ++v) {
+        max_degree = max(max_degree, static_cast<int>(synthetic.offsets[v + 1] - synthetic.offsets[v]));
+    }
+    synthetic = SyntheticGraph();
+    double file_mb = filesystem::file_size(graph_path) / 1e6;
+
+    cout << "Synthetic " << (gen.model == GraphModel::RMat ? "rmat" : "chunglu") << " graph: "
+         << (1 << gen.scale) << " nodes, " << edges / 2 << " edges, max degree " << max_degree
+         << ", " << file_mb << " MB (generated in " << gen_seconds << " s)" << endl;
+
+    // Time every stage at every thread count
+    vector<StageTimes> results(threads.size());
+    vector<double> checksums(threads.size());
+    for (size_t r = 0; r < threads.size(); ++r) {
+        omp_set_num_threads(threads[r]);
+        for (int rep = 0; rep < reps; ++rep) {
+            checksums[r] = runStages(graph_path, part_path, num_parts, weighted, options, layout, vertex_order,
+                                     results[r]);
+        }
+        const StageTimes& t = results[r];
+        cout << "\nThreads " << threads[r] << " -> load " << t.load << " s, halo " << t.halo
+             << " s, compress " << t.compress << " s, score " << t.score << " s, top-K " << t.topk << " s, layer total "
+             << t.layer_total << " s" << endl;
+        cout << "Load: " << edges / t.load << " edges/s (" << file_mb / t.load << " MB/s), score: "
+             << edges / t.score << " intersections/s, adjacency: " << t.bytes_per_edge
+             << " bytes/edge" << endl;
+        if (vertex_order != VertexOrder::None) {
+            cout << "Reorder (" << vertexOrderName(vertex_order) << "): " << t.reorder << " s, score "
+                 << t.score_original << " s -> " << t.score << " s, estimated row miss rate "
+                 << 100.0 * t.miss_before << "% -> " << 100.0 * t.miss_after << "%" << endl;
+        }
+        if (checksums[r] != checksums[0]) {
+            cerr << "Warning: Score checksum differs from the " << threads[0] << "-thread run" << endl;
+        }
+    }
+    long rss = peakRssKb();
+    cout << "\nPeak RSS: " << rss / 1024.0 << " MB" << endl;
+
+    // Machine-readable copy; speedups are against the first thread count
+    ofstream json(json_path);
+    if (!json) {
+        cerr << "Error: Cannot write " << json_path << endl;
+        return 1;
+    }
+    json.precision(9);
+    json << "{\n"
+         << "  \"label\": \"" << label << "\",\n"
+         << "  \"timestamp\": " << time(nullptr) << ",\n"
+         << "  \"graph\": {\"model\": \"" << (gen.model == GraphModel::RMat ? "rmat" : "chunglu")
+         << "\", \"scale\": " << gen.scale << ", \"edge_factor\": " << gen.edge_factor
+         << ", \"seed\": " << gen.seed << ", \"weighted\": " << (weighted ? "true" : "false")
+         << ", \"nodes\": " << (1 << gen.scale) << ", \"edges\": " << edges / 2
+         << ", \"max_degree\": " << max_degree << ", \"file_mb\": " << file_mb
+         << ", \"parts\": " << num_parts << "},\n"
+         << "  \"layout\": \"" << (layout == AdjacencyLayout::Compressed ? "compressed" : "plain") << "\",\n"
+         << "  \"reorder\": \"" << vertexOrderName(vertex_order) << "\",\n"
+         << "  \"reps\": " << reps << ",\n"
+         << "  \"peak_rss_kb\": " << rss << ",\n"
+         << "  \"runs\": [\n";
+    for (size_t r = 0; r < threads.size(); ++r) {
+        const StageTimes& t = results[r];
+        const StageTimes& base = results[0];
+        json << "    {\"threads\": " << threads[r]
+             << ", \"load_s\": " << t.load << ", \"halo_s\": " << t.halo
+             << ", \"compress_s\": " << t.compress
+             << ", \"score_s\": " << t.score << ", \"topk_s\": " << t.topk
+             << ", \"layer_total_s\": " << t.layer_total
+             << ", \"load_edges_per_s\": " << edges / t.load
+             << ", \"load_mb_per_s\": " << file_mb / t.load
+             << ", \"intersections_per_s\": " << edges / t.score
+             << ", \"bytes_per_edge\": " << t.bytes_per_edge;
+        if (vertex_order != VertexOrder::None) {
+            json << ", \"reorder_s\": " << t.reorder << ", \"score_original_s\": " << t.score_original
+                 << ", \"miss_rate_before\": " << t.miss_before << ", \"miss_rate_after\": " << t.miss_after;
+        }
+        json << ", \"speedup\": {\"load\": " << base.load / t.load
+             << ", \"score\": " << base.score / t.score
+             << ", \"topk\": " << base.topk / t.topk
+             << ", \"layer_total\": " << base.layer_total / t.layer_total << "}"
+             << ", \"score_checksum\": " << checksums[r] << "}"
+             << (r + 1 < threads.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    cout << "Results written to " << json_path << endl;
+    return 0;
+}
@@ -0,0 +1,541 @@
+#ifndef BINARYGRAPH_H
+#define BINARYGRAPH_H
+
+#include <cstring>
+#include <cstdint>
+#include <sys/stat.h>
+#include <chrono>
+#include <filesystem>
+
+#include "load_graph.h"
+
+using namespace std;
+
+// Binary graph container written once by convert_binary and mmapped by the
+// drivers instead of re-parsing METIS text. Layout (native byte order, every
+// section 8-byte aligned):
+//
+//   BinaryGraphHeader
+//   BinaryPartitionEntry[num_parts]
+//   int32 partition[num_nodes]       partition of METIS node i+1
+//   int32 real_ids[mapping_size]     METIS ID -> real-world ID, -1 if none
+//   per partition: int32 vertex_ids, int64 offsets, int32 neighbors,
+//                  int32 weights (omitted for unweighted graphs)
+//
+// The header records the size and mtime of the text files it was built from
+// and a checksum over the header and partition table, so a stale or damaged
+// container is rejected instead of being used. The data sections are not
+// hashed, since a rank maps only the pages it needs; their offsets and
+// neighbor indices are range-checked as they are read instead.
+
+const char BINARY_GRAPH_MAGIC[8] = {'H', 'G', 'C', 'S', 'R', 'B', 'I', 'N'};
+const uint32_t BINARY_GRAPH_VERSION = 1;
+
+struct SourceStamp {
+    uint64_t size;
+    int64_t mtime;
+};
+
+struct BinaryGraphHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_parts;
+    uint32_t weighted;
+    uint32_t reserved;
+    int64_t num_nodes;
+    int64_t mapping_size;
+    SourceStamp sources[3];     // graph, partition and mapping file
+    uint64_t partition_offset;
+    uint64_t mapping_offset;
+    uint64_t file_size;
+    uint64_t checksum;
+};
+
+struct BinaryPartitionEntry {
+    int64_t num_local;
+    int64_t num_vertices;
+    int64_t num_edges;
+    uint64_t vertex_ids_offset;
+    uint64_t offsets_offset;
+    uint64_t neighbors_offset;
+    uint64_t weights_offset;    // 0 when the graph is unweighted
+};
+
+inline uint64_t fnv1a(const void* data, size_t len, uint64_t hash = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+SourceStamp sourceStamp(const string& path) {
+    SourceStamp stamp = {0, 0};
+    struct stat st;
+    if (!path.empty() && stat(path.c_str(), &st) == 0) {
+        stamp.size = static_cast<uint64_t>(st.st_size);
+        stamp.mtime = static_cast<int64_t>(st.st_mtime);
+    }
+    return stamp;
+}
+
+uint64_t binaryGraphChecksum(BinaryGraphHeader header, const BinaryPartitionEntry* table) {
+    header.checksum = 0;
+    uint64_t hash = fnv1a(&header, sizeof(header));
+    return fnv1a(table, sizeof(BinaryPartitionEntry) * header.num_parts, hash);
+}
+
+string binaryGraphPath(const string& graph_file, int num_parts) {
+    return graph_file + "." + to_string(num_parts) + ".bin";
+}
+
+namespace binary_detail {
+
+inline void pad(ofstream& out, uint64_t& pos) {
+    static const char zeros[8] = {0};
+    uint64_t rem = pos % 8;
+    if (rem) {
+        out.write(zeros, 8 - rem);
+        pos += 8 - rem;
+    }
+}
+
+template <typename T>
+uint64_t writeSection(ofstream& out, uint64_t& pos, const vector<T>& data) {
+    pad(out, pos);
+    uint64_t start = pos;
+    out.write(reinterpret_cast<const char*>(data.data()), sizeof(T) * data.size());
+    pos += sizeof(T) * data.size();
+    return start;
+}
+
+template <typename T>
+bool copySection(const MappedFile& file, uint64_t offset, int64_t count, vector<T>& out) {
+    if (count < 0 || offset % alignof(T) != 0 ||
+        offset + sizeof(T) * static_cast<uint64_t>(count) > file.size) {
+        return false;
+    }
+    const T* src = reinterpret_cast<const T*>(file.data + offset);
+    out.assign(src, src + count);
+    return true;
+}
+
+// Row offsets of a stored partition must rise from 0 to num_edges, and every
+// neighbor must index one of its num_vertices vertices.
+inline bool validRows(const CSRGraph& g, int64_t num_edges) {
+    int64_t n = static_cast<int64_t>(g.vertex_ids.size());
+    if (g.num_local < 0 || g.num_local > n || g.offsets.empty() ||
+        g.offsets.front() != 0 || g.offsets.back() != num_edges) {
+        return false;
+    }
+    for (size_t v = 1; v < g.offsets.size(); ++v) {
+        if (g.offsets[v] < g.offsets[v - 1]) return false;
+    }
+    for (int nbr : g.neighbors) {
+        if (nbr < 0 || nbr >= n) return false;
+    }
+    return true;
+}
+
+}
+
+bool writeBinaryGraph(const string& bin_file,
+                      const string& graph_file,
+                      const string& part_file,
+                      const string& mapping_file,
+                      const vector<CSRGraph>& subgraphs,
+                      const vector<int>& partitions,
+                      const vector<int>& mapping,
+                      bool weighted) {
+    using namespace binary_detail;
+
+    string tmp_file = bin_file + ".tmp";
+    ofstream out(tmp_file, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Error: Cannot write binary graph: " << tmp_file << endl;
+        return false;
+    }
+
+    BinaryGraphHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic));
+    header.version = BINARY_GRAPH_VERSION;
+    header.num_parts = static_cast<uint32_t>(subgraphs.size());
+    header.weighted = weighted ? 1 : 0;
+    header.num_nodes = static_cast<int64_t>(partitions.size());
+    header.mapping_size = static_cast<int64_t>(mapping.size());
+    header.sources[0] = sourceStamp(graph_file);
+    header.sources[1] = sourceStamp(part_file);
+    header.sources[2] = sourceStamp(mapping_file);
+
+    vector<BinaryPartitionEntry> table(subgraphs.size());
+    memset(table.data(), 0, sizeof(BinaryPartitionEntry) * table.size());
+
+    // Header and table are rewritten once all section offsets are known
+    uint64_t pos = sizeof(header) + sizeof(BinaryPartitionEntry) * table.size();
+    out.seekp(pos);
+    header.partition_offset = writeSection(out, pos, partitions);
+    header.mapping_offset = writeSection(out, pos, mapping);
+    for (size_t p = 0; p < subgraphs.size(); ++p) {
+        const CSRGraph& g = subgraphs[p];
+        table[p].num_local = g.num_local;
+        table[p].num_vertices = g.numVertices();
+        table[p].num_edges = g.numEdges();
+        table[p].vertex_ids_offset = writeSection(out, pos, g.vertex_ids);
+        table[p].offsets_offset = writeSection(out, pos, g.offsets);
+        table[p].neighbors_offset = writeSection(out, pos, g.neighbors);
+        if (weighted) {
+            table[p].weights_offset = writeSection(out, pos, g.weights);
+        }
+    }
+    header.file_size = pos;
+    header.checksum = binaryGraphChecksum(header, table.data());
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), sizeof(BinaryPartitionEntry) * table.size());
+    out.close();
+    if (!out) {
+        cerr << "Error: Failed writing binary graph: " << tmp_file << endl;
+        return false;
+    }
+
+    if (rename(tmp_file.c_str(), bin_file.c_str()) != 0) {
+        cerr << "Error: Cannot rename " << tmp_file << " to " << bin_file << endl;
+        return false;
+    }
+    return true;
+}
+
+// Checks magic, version, partition count, size, checksum and source stamps of
+// a mapped container and copies out its header and partition table.
+bool validateBinaryGraph(const MappedFile& file,
+                         const string& bin_file,
+                         const string& graph_file,
+                         const string& part_file,
+                         const string& mapping_file,
+                         size_t num_parts,
+                         BinaryGraphHeader& header,
+                         vector<BinaryPartitionEntry>& table) {
+    if (!file.data || file.size < sizeof(BinaryGraphHeader)) {
+        cerr << "Warning: Cannot map binary graph " << bin_file << ", falling back to text" << endl;
+        return false;
+    }
+
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BINARY_GRAPH_VERSION) {
+        cerr << "Warning: " << bin_file << " is not a version " << BINARY_GRAPH_VERSION
+             << " binary graph, falling back to text" << endl;
+        return false;
+    }
+    if (header.num_parts != num_parts) {
+        cerr << "Warning: " << bin_file << " holds " << header.num_parts << " partitions, expected "
+             << num_parts << ", falling back to text" << endl;
+        return false;
+    }
+
+    size_t table_bytes = sizeof(BinaryPartitionEntry) * header.num_parts;
+    if (header.file_size != file.size || sizeof(header) + table_bytes > file.size) {
+        cerr << "Warning: " << bin_file << " is truncated, falling back to text" << endl;
+        return false;
+    }
+    table.resize(header.num_parts);
+    memcpy(table.data(), file.data + sizeof(header), table_bytes);
+    if (binaryGraphChecksum(header, table.data()) != header.checksum) {
+        cerr << "Warning: Checksum mismatch in " << bin_file << ", falling back to text" << endl;
+        return false;
+    }
+
+    // Sources that are still present must be the ones the container was built from
+    const string* sources[3] = {&graph_file, &part_file, &mapping_file};
+    for (int i = 0; i < 3; ++i) {
+        SourceStamp now = sourceStamp(*sources[i]);
+        if (now.size == 0 && now.mtime == 0) continue;
+        if (now.size != header.sources[i].size || now.mtime != header.sources[i].mtime) {
+            cerr << "Warning: " << bin_file << " is stale (" << *sources[i]
+                 << " changed), falling back to text" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool copyBinaryPartition(const MappedFile& file,
+                         const BinaryGraphHeader& header,
+                         const BinaryPartitionEntry& entry,
+                         CSRGraph& g) {
+    using namespace binary_detail;
+
+    g.num_local = static_cast<int>(entry.num_local);
+    bool ok = copySection(file, entry.vertex_ids_offset, entry.num_vertices, g.vertex_ids) &&
+              copySection(file, entry.offsets_offset, entry.num_local + 1, g.offsets) &&
+              copySection(file, entry.neighbors_offset, entry.num_edges, g.neighbors);
+    if (ok && header.weighted) {
+        ok = copySection(file, entry.weights_offset, entry.num_edges, g.weights);
+    } else if (ok) {
+        g.weights.assign(entry.num_edges, 1);
+    }
+    return ok && validRows(g, entry.num_edges);
+}
+
+// Maps a container written by writeBinaryGraph and fills `subgraphs` (sized
+// to the expected partition count) and the METIS -> real ID `mapping`.
+// Returns false without touching the outputs when the file is missing, built
+// for a different partition count, damaged, or older than its sources.
+bool loadBinaryGraph(const string& bin_file,
+                     const string& graph_file,
+                     const string& part_file,
+                     const string& mapping_file,
+                     vector<CSRGraph>& subgraphs,
+                     vector<int>& mapping) {
+    if (!filesystem::exists(bin_file)) return false;
+
+    MappedFile file(bin_file);
+    BinaryGraphHeader header;
+    vector<BinaryPartitionEntry> table;
+    if (!validateBinaryGraph(file, bin_file, graph_file, part_file, mapping_file,
+                             subgraphs.size(), header, table)) {
+        return false;
+    }
+
+    vector<CSRGraph> loaded(header.num_parts);
+    vector<int> loaded_mapping;
+    bool ok = binary_detail::copySection(file, header.mapping_offset, header.mapping_size, loaded_mapping);
+    for (uint32_t p = 0; ok && p < header.num_parts; ++p) {
+        ok = copyBinaryPartition(file, header, table[p], loaded[p]);
+    }
+    if (!ok) {
+        cerr << "Warning: Section out of range in " << bin_file << ", falling back to text" << endl;
+        return false;
+    }
+
+    subgraphs = move(loaded);
+    mapping = move(loaded_mapping);
+    return true;
+}
+
+// Fills the halo of `graph` by looking each ghost up in its owner's section
+// of the mapped container; only the pages of those rows are touched.
+bool loadBinaryHalo(const MappedFile& file,
+                    const vector<BinaryPartitionEntry>& table,
+                    const vector<int>& partitions,
+                    CSRGraph& graph) {
+    vector<int> packed;
+    for (int v = graph.num_local; v < graph.numVertices(); ++v) {
+        int id = graph.vertex_ids[v];
+        if (id < 1 || id > static_cast<int>(partitions.size())) {
+            packed.push_back(0);
+            continue;
+        }
+        int owner = partitions[id - 1];
+        if (owner < 0 || owner >= static_cast<int>(table.size())) return false;
+        const BinaryPartitionEntry& entry = table[owner];
+        if (entry.num_local < 0 || entry.num_local > entry.num_vertices ||
+            entry.vertex_ids_offset + sizeof(int) * entry.num_vertices > file.size ||
+            entry.offsets_offset + sizeof(int64_t) * (entry.num_local + 1) > file.size ||
+            entry.neighbors_offset + sizeof(int) * entry.num_edges > file.size) {
+            return false;
+        }
+        const int* ids = reinterpret_cast<const int*>(file.data + entry.vertex_ids_offset);
+        const int64_t* offsets = reinterpret_cast<const int64_t*>(file.data + entry.offsets_offset);
+        const int* neighbors = reinterpret_cast<const int*>(file.data + entry.neighbors_offset);
+
+        // Local vertices of a stored partition are in ascending METIS order
+        const int* it = lower_bound(ids, ids + entry.num_local, id);
+        if (it == ids + entry.num_local || *it != id) {
+            packed.push_back(0);
+            continue;
+        }
+        int64_t l = it - ids;
+        if (offsets[l] < 0 || offsets[l] > offsets[l + 1] || offsets[l + 1] > entry.num_edges) {
+            return false;
+        }
+        packed.push_back(static_cast<int>(offsets[l + 1] - offsets[l]));
+        for (int64_t e = offsets[l]; e < offsets[l + 1]; ++e) {
+            if (neighbors[e] < 0 || neighbors[e] >= entry.num_vertices) return false;
+            packed.push_back(ids[neighbors[e]]);
+        }
+    }
+    setHalo(graph, packed);
+    return true;
+}
+
+// Like loadBinaryGraph, but copies only the listed partitions (merged into one
+// CSRGraph), touching just the pages of their sections. With `with_halo` the
+// ghost rows are read from the container as well. The mapping and the
+// partition vector are returned only when the corresponding pointer is
+// non-null.
+bool loadBinaryGraphParts(const string& bin_file,
+                          const string& graph_file,
+                          const string& part_file,
+                          const string& mapping_file,
+                          const vector<int>& parts,
+                          int num_parts,
+                          CSRGraph& graph,
+                          vector<int>* mapping,
+                          vector<int>* partitions = nullptr,
+                          bool with_halo = false) {
+    if (!filesystem::exists(bin_file)) return false;
+
+    MappedFile file(bin_file);
+    BinaryGraphHeader header;
+    vector<BinaryPartitionEntry> table;
+    if (!validateBinaryGraph(file, bin_file, graph_file, part_file, mapping_file,
+                             num_parts, header, table)) {
+        return false;
+    }
+
+    vector<CSRGraph> pieces(parts.size());
+    vector<int> loaded_mapping, loaded_partitions;
+    bool ok = true;
+    for (size_t i = 0; ok && i < parts.size(); ++i) {
+        ok = copyBinaryPartition(file, header, table[parts[i]], pieces[i]);
+    }
+    if (ok && mapping) {
+        ok = binary_detail::copySection(file, header.mapping_offset, header.mapping_size, loaded_mapping);
+    }
+    if (ok && (partitions || with_halo)) {
+        ok = binary_detail::copySection(file, header.partition_offset, header.num_nodes, loaded_partitions);
+    }
+
+    CSRGraph loaded;
+    if (ok) {
+        loaded = pieces.size() == 1 ? move(pieces[0]) : mergeSubgraphs(pieces);
+    }
+    if (ok && with_halo) {
+        ok = loadBinaryHalo(file, table, loaded_partitions, loaded);
+    }
+    if (!ok) {
+        cerr << "Warning: Section out of range in " << bin_file << ", falling back to text" << endl;
+        return false;
+    }
+
+    graph = move(loaded);
+    if (mapping) *mapping = move(loaded_mapping);
+    if (partitions) *partitions = move(loaded_partitions);
+    return true;
+}
+
+// Sidecar line index of a METIS text file (graphs/<name>.graph.lines),
+// written next to the container so ranks that fall back to text can parse
+// only their own lines. Layout: LineIndexHeader, then int64 starts[num_lines + 1].
+const char LINE_INDEX_MAGIC[8] = {'H', 'G', 'L', 'I', 'N', 'E', 'S', '1'};
+
+struct LineIndexHeader {
+    char magic[8];
+    SourceStamp source;         // the graph file
+    int64_t num_lines;
+    uint64_t checksum;          // over the header and the offsets
+};
+
+string lineIndexPath(const string& graph_file) {
+    return graph_file + ".lines";
+}
+
+bool writeLineIndex(const string& graph_file, const MetisLineIndex& index) {
+    string path = lineIndexPath(graph_file), tmp_file = path + ".tmp";
+    LineIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LINE_INDEX_MAGIC, sizeof(header.magic));
+    header.source = sourceStamp(graph_file);
+    header.num_lines = index.numLines();
+    header.checksum = fnv1a(index.starts.data(), sizeof(int64_t) * index.starts.size(),
+                            fnv1a(&header, sizeof(header)));
+
+    ofstream out(tmp_file, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(index.starts.data()), sizeof(int64_t) * index.starts.size());
+    out.close();
+    if (!out || rename(tmp_file.c_str(), path.c_str()) != 0) {
+        cerr << "Error: Cannot write line index: " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Reads the sidecar index of `graph_file`. Returns false, leaving `index`
+// empty, if there is none or it does not belong to the current file.
+bool loadLineIndex(const string& graph_file, MetisLineIndex& index) {
+    string path = lineIndexPath(graph_file);
+    MappedFile file(path);
+    if (!file.opened) return false;
+
+    LineIndexHeader header;
+    if (file.size < sizeof(header)) {
+        cerr << "Warning: " << path << " is truncated, ignoring it" << endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    SourceStamp now = sourceStamp(graph_file);
+    uint64_t bytes = sizeof(int64_t) * static_cast<uint64_t>(header.num_lines + 1);
+    if (memcmp(header.magic, LINE_INDEX_MAGIC, sizeof(header.magic)) != 0 || header.num_lines < 0 ||
+        file.size != sizeof(header) + bytes) {
+        cerr << "Warning: " << path << " is not a line index, ignoring it" << endl;
+        return false;
+    }
+    if (now.size != header.source.size || now.mtime != header.source.mtime) {
+        cerr << "Warning: " << path << " is stale (" << graph_file << " changed), ignoring it" << endl;
+        return false;
+    }
+
+    uint64_t checksum = header.checksum;
+    header.checksum = 0;
+    const char* starts = file.data + sizeof(header);
+    if (fnv1a(starts, bytes, fnv1a(&header, sizeof(header))) != checksum) {
+        cerr << "Warning: Checksum mismatch in " << path << ", ignoring it" << endl;
+        return false;
+    }
+    index.starts.resize(header.num_lines + 1);
+    memcpy(index.starts.data(), starts, bytes);
+    index.file_size = now.size;
+    return true;
+}
+
+// One-time conversion of one layer's graphs/ + gparts/ text files into its
+// container for `num_parts` partitions, as convert_binary does for every
+// layer. Returns false if an input is missing or the container cannot be
+// written.
+bool buildBinaryLayer(const string& gtype, int num_parts = NUM_PARTS) {
+    string base = "higgs-" + gtype + "_network";
+    string graph_path = "graphs/" + base + ".graph";
+    string part_path = "gparts/" + base + ".graph.part." + to_string(num_parts);
+    string map_path = "gparts/" + base + ".graph.mapping.txt";
+    bool use_mapping = (gtype != "social");
+
+    if (!filesystem::exists(graph_path) || !filesystem::exists(part_path) ||
+        (use_mapping && !filesystem::exists(map_path))) {
+        cerr << "Missing file(s) for graph type: " << gtype << endl;
+        return false;
+    }
+
+    auto start_time = chrono::high_resolution_clock::now();
+
+    vector<int> partitions = loadPartitions(part_path, num_parts);
+    vector<int> mapping;
+    if (use_mapping) {
+        mapping = loadMapping(map_path);
+    }
+    vector<CSRGraph> subgraphs(num_parts);
+    if (!loadGraph(graph_path, part_path, subgraphs, use_mapping)) return false;
+
+    MetisLineIndex line_index;
+    if (!buildLineIndex(graph_path, line_index) || !writeLineIndex(graph_path, line_index)) {
+        return false;
+    }
+
+    string bin_path = binaryGraphPath(graph_path, num_parts);
+    if (!writeBinaryGraph(bin_path, graph_path, part_path, use_mapping ? map_path : "",
+                          subgraphs, partitions, mapping, use_mapping)) {
+        return false;
+    }
+
+    auto end_time = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+    cout << "Wrote " << bin_path << " (" << filesystem::file_size(bin_path) << " bytes) in "
+         << duration.count() / 1000.0 << " seconds" << endl;
+    return true;
+}
+
+#endif
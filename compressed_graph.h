@@ -0,0 +1,382 @@
+#ifndef COMPRESSED_GRAPH_H
+#define COMPRESSED_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+
+#include "load_graph.h"
+#include "Influence.h"
+#include "profile.h"
+
+using namespace std;
+
+// Which in-memory adjacency layout the drivers score from.
+//   Plain:      CSRGraph, 4-byte neighbor and weight per edge
+//   Compressed: CompressedGraph, delta + varint coded rows decoded on the fly
+enum class AdjacencyLayout { Plain, Compressed };
+
+AdjacencyLayout parseAdjacencyLayout(const string& name) {
+    if (name == "compressed") return AdjacencyLayout::Compressed;
+    return AdjacencyLayout::Plain;
+}
+
+// Same graph as a CSRGraph with halo, in compressed form. Every row (local
+// rows, then halo rows of ghosts) is stored as its first local ID followed
+// by the gaps between consecutive IDs in group varint: each group of four
+// gaps is a tag byte holding their byte lengths, then the gaps in 1-4 bytes,
+// so most neighbors of a partition take under two bytes and a group decodes
+// without a branch per byte. Rows longer than SKIP_BLOCK IDs start with a
+// skip table: for every block after the first, the last ID before it and its
+// byte offset, so an intersection can jump over blocks of a hub row without
+// decoding them. Weights of local rows are run-length coded as (run length,
+// weight) base-128 varints, which is two bytes for a row whose weights are
+// all equal; a graph whose weights are all 1 stores no weight stream at all.
+struct CompressedGraph {
+    int num_local = 0;
+    vector<int> vertex_ids;         // as in CSRGraph
+    vector<int> lengths;            // row length of every vertex, -1 if unknown
+    vector<int64_t> row_bytes;      // byte offset of each row, size numVertices() + 1
+    vector<uint8_t> rows;
+    vector<int> ghost_degrees;      // full degree of each ghost
+    bool unit_weights = true;
+    vector<int64_t> weight_bytes;   // byte offset of each local row's runs
+    vector<uint8_t> weight_runs;
+    int64_t num_edges = 0;          // local row entries
+
+    int numVertices() const { return static_cast<int>(vertex_ids.size()); }
+    int64_t numEdges() const { return num_edges; }
+    int degree(int v) const { return lengths[v]; }
+    const uint8_t* row(int v) const { return rows.data() + row_bytes[v]; }
+
+    // Full degree; for ghosts this counts neighbors outside the partition too
+    int fullDegree(int v) const { return v < num_local ? lengths[v] : ghost_degrees[v - num_local]; }
+
+    size_t bytes() const {
+        return vertex_ids.size() * sizeof(int) + lengths.size() * sizeof(int) +
+               row_bytes.size() * sizeof(int64_t) + rows.size() +
+               ghost_degrees.size() * sizeof(int) + weight_bytes.size() * sizeof(int64_t) +
+               weight_runs.size();
+    }
+};
+
+// Bytes held by the plain layout, for comparison with CompressedGraph::bytes().
+size_t adjacencyBytes(const CSRGraph& g) {
+    return g.vertex_ids.size() * sizeof(int) + g.offsets.size() * sizeof(int64_t) +
+           g.neighbors.size() * sizeof(int) + g.weights.size() * sizeof(int) +
+           g.halo_offsets.size() * sizeof(int64_t) + g.halo_neighbors.size() * sizeof(int) +
+           g.halo_degrees.size() * sizeof(int);
+}
+
+// IDs per block of a skip table
+const int SKIP_BLOCK = 64;
+
+namespace compressed_detail {
+
+inline int varintSize(uint32_t x) {
+    int n = 1;
+    while (x >= 0x80) {
+        x >>= 7;
+        n++;
+    }
+    return n;
+}
+
+inline uint8_t* putVarint(uint8_t* p, uint32_t x) {
+    while (x >= 0x80) {
+        *p++ = static_cast<uint8_t>(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = static_cast<uint8_t>(x);
+    return p;
+}
+
+inline uint32_t getVarint(const uint8_t*& p) {
+    uint32_t x = *p++;
+    if (x < 0x80) return x;     // one-byte gaps are the common case
+    x &= 0x7F;
+    int shift = 7;
+    while (true) {
+        uint32_t b = *p++;
+        x |= (b & 0x7F) << shift;
+        if (b < 0x80) return x;
+        shift += 7;
+    }
+}
+
+// Skip table entry: last ID before the block, block offset past the table
+struct SkipEntry {
+    int32_t base;
+    uint32_t offset;
+};
+
+inline int skipEntries(int len) {
+    return len > SKIP_BLOCK ? (len - 1) / SKIP_BLOCK : 0;
+}
+
+inline SkipEntry skipEntry(const uint8_t* row, int b) {
+    SkipEntry entry;
+    memcpy(&entry, row + (b - 1) * sizeof(SkipEntry), sizeof(SkipEntry));
+    return entry;
+}
+
+// Group varint. Decoding loads 4 bytes per value and masks, so the row
+// buffer carries GROUP_PAD spare bytes at the end. Byte order is little-endian.
+const int GROUP_PAD = 3;
+const uint32_t GROUP_MASK[5] = {0, 0xFFu, 0xFFFFu, 0xFFFFFFu, 0xFFFFFFFFu};
+
+inline int byteLength(uint32_t x) {
+    return x < (1u << 8) ? 1 : x < (1u << 16) ? 2 : x < (1u << 24) ? 3 : 4;
+}
+
+// Decodes the next `count` (at most 4) gaps of a group into out
+inline const uint8_t* getGroup(const uint8_t* p, int count, uint32_t* out) {
+    uint32_t tag = *p++;
+    for (int j = 0; j < count; ++j) {
+        int n = ((tag >> (2 * j)) & 3) + 1;
+        uint32_t x;
+        memcpy(&x, p, sizeof(x));
+        out[j] = x & GROUP_MASK[n];
+        p += n;
+    }
+    return p;
+}
+
+inline int64_t rowSize(const int* ids, int len) {
+    int64_t size = skipEntries(len) * sizeof(SkipEntry) + (len + 3) / 4;
+    int prev = 0;
+    for (int i = 0; i < len; ++i) {
+        size += byteLength(static_cast<uint32_t>(ids[i] - prev));
+        prev = ids[i];
+    }
+    return size;
+}
+
+inline void putRow(uint8_t* p, const int* ids, int len) {
+    uint8_t* table = p;
+    uint8_t* data = p + skipEntries(len) * sizeof(SkipEntry);
+    uint8_t* q = data;
+    int prev = 0;
+    for (int i = 0; i < len; i += 4) {
+        if (i > 0 && i % SKIP_BLOCK == 0) {
+            SkipEntry entry = {prev, static_cast<uint32_t>(q - data)};
+            memcpy(table + (i / SKIP_BLOCK - 1) * sizeof(SkipEntry), &entry, sizeof(SkipEntry));
+        }
+        uint8_t* tag = q++;
+        *tag = 0;
+        for (int j = 0; j < 4 && i + j < len; ++j) {
+            uint32_t gap = static_cast<uint32_t>(ids[i + j] - prev);
+            int n = byteLength(gap);
+            *tag |= static_cast<uint8_t>((n - 1) << (2 * j));
+            for (int k = 0; k < n; ++k) *q++ = static_cast<uint8_t>(gap >> (8 * k));
+            prev = ids[i + j];
+        }
+    }
+}
+
+// Decodes IDs [from, len) of a row whose data starts at q with running value
+// `value`, into out, stopping after the first ID above `limit`. `from` is a
+// multiple of 4. Returns the number of IDs written that are <= limit.
+inline int decodeIds(const uint8_t* q, int from, int len, int value, int limit, int* out) {
+    int m = 0;
+    uint32_t gaps[4];
+    for (int k = from; k < len; k += 4) {
+        int count = min(4, len - k);
+        q = getGroup(q, count, gaps);
+        for (int j = 0; j < count; ++j) {
+            value += static_cast<int>(gaps[j]);
+            out[m++] = value;
+        }
+        if (value > limit) break;
+    }
+    while (m > 0 && out[m - 1] > limit) m--;
+    return m;
+}
+
+// Calls f(run, weight) for each run of equal weights in the row
+template <class F>
+inline void forEachRun(const int* weights, int len, F f) {
+    for (int i = 0; i < len;) {
+        int j = i;
+        while (j < len && weights[j] == weights[i]) j++;
+        f(j - i, weights[i]);
+        i = j;
+    }
+}
+
+// Per-row sizes stored at [v + 1] become offsets
+inline void prefixSum(vector<int64_t>& offsets) {
+    for (size_t i = 1; i < offsets.size(); ++i) offsets[i] += offsets[i - 1];
+}
+
+}
+
+// Encodes `graph` (with or without halo) in the compressed layout.
+CompressedGraph compressGraph(const CSRGraph& graph) {
+    using namespace compressed_detail;
+    CompressedGraph c;
+    int n = graph.numVertices(), nl = graph.num_local;
+    c.num_local = nl;
+    c.vertex_ids = graph.vertex_ids;
+    c.num_edges = graph.numEdges();
+    c.lengths.assign(n, -1);
+    c.row_bytes.assign(n + 1, 0);
+    if (graph.hasHalo()) c.ghost_degrees = graph.halo_degrees;
+    else c.ghost_degrees.assign(graph.numGhosts(), 0);
+
+    // Pass 1: encoded size of every row
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < n; ++v) {
+        const int* ids;
+        int len, degree;
+        if (!neighborRow(graph, v, ids, len, degree)) continue;
+        c.lengths[v] = len;
+        c.row_bytes[v + 1] = rowSize(ids, len);
+    }
+    prefixSum(c.row_bytes);
+    c.rows.resize(c.row_bytes[n] + GROUP_PAD);
+
+    // Pass 2: encode into place
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < n; ++v) {
+        const int* ids;
+        int len, degree;
+        if (neighborRow(graph, v, ids, len, degree)) putRow(c.rows.data() + c.row_bytes[v], ids, len);
+    }
+
+    for (int w : graph.weights) {
+        if (w != 1) {
+            c.unit_weights = false;
+            break;
+        }
+    }
+    if (c.unit_weights) return c;
+
+    c.weight_bytes.assign(nl + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < nl; ++v) {
+        int64_t size = 0;
+        forEachRun(graph.rowWeights(v), graph.degree(v), [&](int run, int w) {
+            size += varintSize(run) + varintSize(static_cast<uint32_t>(w));
+        });
+        c.weight_bytes[v + 1] = size;
+    }
+    prefixSum(c.weight_bytes);
+    c.weight_runs.resize(c.weight_bytes[nl]);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < nl; ++v) {
+        uint8_t* p = c.weight_runs.data() + c.weight_bytes[v];
+        forEachRun(graph.rowWeights(v), graph.degree(v), [&](int run, int w) {
+            p = putVarint(p, run);
+            p = putVarint(p, static_cast<uint32_t>(w));
+        });
+    }
+    return c;
+}
+
+// Decodes row v into `out` (resized to its length).
+inline void decodeRow(const CompressedGraph& g, int v, vector<int>& out) {
+    using namespace compressed_detail;
+    int len = max(g.lengths[v], 0);
+    out.resize(len + 3);
+    decodeIds(g.row(v) + skipEntries(len) * sizeof(SkipEntry), 0, len, 0, INT32_MAX, out.data());
+    out.resize(len);
+}
+
+// Decodes the weights of local row v into `out`.
+inline void decodeWeights(const CompressedGraph& g, int v, vector<int>& out) {
+    using namespace compressed_detail;
+    out.resize(g.lengths[v]);
+    if (g.unit_weights) {
+        fill(out.begin(), out.end(), 1);
+        return;
+    }
+    const uint8_t* p = g.weight_runs.data() + g.weight_bytes[v];
+    for (size_t i = 0; i < out.size();) {
+        int run = static_cast<int>(getVarint(p));
+        int w = static_cast<int>(getVarint(p));
+        fill(out.begin() + i, out.begin() + i + run, w);
+        i += run;
+    }
+}
+
+// Size of the intersection of the sorted plain list `a` with the compressed
+// row starting at `p` (len IDs). Only the part of the row that can overlap
+// `a` is decoded: blocks ending below a[0] are skipped with the skip table
+// and decoding stops once it passes the last element of `a`. The decoded run
+// goes through a tight loop into `buf` and is then intersected with the
+// regular kernels, which is faster than merging while decoding.
+inline int intersectCompressed(const int* a, int na, const uint8_t* p, int len, vector<int>& buf) {
+    using namespace compressed_detail;
+    if (na == 0 || len <= 0) return 0;
+    int entries = skipEntries(len);
+    const uint8_t* q = p + entries * sizeof(SkipEntry);
+    int first = a[0], last = a[na - 1];
+
+    int b = 0, value = 0;
+    while (b < entries && skipEntry(p, b + 1).base < first) b++;
+    if (b > 0) {
+        SkipEntry entry = skipEntry(p, b);
+        q += entry.offset;
+        value = entry.base;
+    }
+
+    buf.resize(len - b * SKIP_BLOCK + 3);
+    int m = decodeIds(q, b * SKIP_BLOCK, len, value, last, buf.data());
+    return intersectionCount(a, na, buf.data(), m);
+}
+
+// Per-vertex scores from the compressed layout. Each vertex decodes its own
+// row and weights once, then streams every neighbor's row against it. Rows
+// are summed in edge order, so scores match computeInfluenceScores with the
+// static or dynamic schedule bit for bit.
+vector<double> computeInfluenceScoresCompressed(const CompressedGraph& graph,
+                                                ThreadStats* stats = nullptr) {
+    int n = graph.num_local;
+    vector<double> scores(n, 0.0);
+
+    if (stats) {
+        stats->busy_seconds.assign(omp_get_max_threads(), 0.0);
+        stats->tasks.assign(omp_get_max_threads(), 0);
+    }
+
+    #pragma omp parallel
+    {
+        double start = omp_get_wtime();
+        long long count = 0, intersections = 0, comparisons = 0, skipped = 0;
+        vector<int> row, weights, buf;
+
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (int node = 0; node < n; node++) {
+            decodeRow(graph, node, row);
+            decodeWeights(graph, node, weights);
+            int node_degree = static_cast<int>(row.size());
+            double score = 0.0;
+
+            for (int e = 0; e < node_degree; e++) {
+                int nbr = row[e];
+                int nbr_len = graph.degree(nbr);
+                // Skip if neighbor's neighbors are not known
+                if (nbr_len < 0) {
+                    skipped++;
+                    continue;
+                }
+                int intersection = intersectCompressed(row.data(), node_degree, graph.row(nbr), nbr_len, buf);
+                intersections++;
+                comparisons += node_degree + nbr_len;
+                score += weights[e] * edgeJaccard(intersection, node_degree, graph.fullDegree(nbr));
+            }
+            scores[node] = score;
+            count++;
+        }
+        profileCount(intersections, comparisons, skipped);
+
+        influence_detail::recordBusy(stats, omp_get_wtime() - start, count);
+    }
+
+    return scores;
+}
+
+#endif
@@ -0,0 +1,43 @@
+// g++ -std=c++17 -O2 -fopenmp -o convert_binary convert_binary.cpp
+// ./convert_binary [--parts N]
+//
+// One-time conversion of graphs/*.graph + gparts/*.part.N (+ mapping) into the
+// binary container read by serial_influence and run_mpi. N defaults to 8; run
+// it once per partition count the drivers are started with.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include "load_graph.h"
+#include "binary_graph.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    int num_parts = NUM_PARTS;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--parts" && i + 1 < argc) {
+            num_parts = atoi(argv[++i]);
+        } else {
+            cerr << "Usage: " << argv[0] << " [--parts N]" << endl;
+            return 1;
+        }
+    }
+    if (num_parts < 1) {
+        cerr << "--parts must be at least 1" << endl;
+        return 1;
+    }
+
+    int converted = 0;
+
+    for (const auto& gtype : graph_types) {
+        if (buildBinaryLayer(gtype, num_parts)) converted++;
+    }
+
+    const IngestStats& ingest = ingestStats();
+    cout << "Text ingest: " << ingest.bytes / 1e6 << " MB in " << ingest.seconds
+         << " s (" << ingest.megabytesPerSecond() << " MB/s)" << endl;
+
+    return converted > 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// g++ -std=c++17 -O2 -fopenmp -o convert_edgelist convert_edgelist.cpp
+// ./convert_edgelist [--binary] [--parts N]
+//
+// Converts datasets/higgs-*_network.edgelist into graphs/*.graph plus the node
+// mapping, with the same output as weighted_edgelistToGraph.py (mention,
+// retweet, reply) and unweighted_edgelistToGraph.py (social). --binary also
+// builds the binary container of every layer whose gpmetis partition into
+// --parts N parts (default 8) is in gparts/.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include "load_graph.h"
+#include "binary_graph.h"
+#include "edgelist.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    bool binary = false;
+    int num_parts = NUM_PARTS;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--parts" && i + 1 < argc) {
+            num_parts = atoi(argv[++i]);
+        } else {
+            cerr << "Warning: Unknown argument '" << arg << "'" << endl;
+        }
+    }
+    if (num_parts < 1) {
+        cerr << "--parts must be at least 1" << endl;
+        return 1;
+    }
+
+    filesystem::create_directories("graphs");
+    int converted = 0;
+
+    for (const auto& gtype : graph_types) {
+        string base = "higgs-" + gtype + "_network";
+        string input_path = "datasets/" + base + ".edgelist";
+        string graph_path = "graphs/" + base + ".graph";
+
+        if (!filesystem::exists(input_path)) {
+            cerr << "Warning: Input file " << input_path << " not found. Skipping." << endl;
+            continue;
+        }
+
+        // The social layer went through the unweighted script, the others
+        // through the weighted one, which sniffs the first lines for weights
+        bool social = (gtype == "social");
+        bool weighted = !social && looksWeighted(input_path);
+        string map_path = social ? "graphs/" + base + ".mapping" : graph_path + ".mapping.txt";
+        MappingFormat format = social ? MappingFormat::MetisToReal : MappingFormat::RealToMetis;
+
+        double start = omp_get_wtime();
+        EdgeListGraph graph;
+        int64_t bad_lines = 0;
+        if (!readEdgeList(input_path, weighted, graph, bad_lines)) {
+            continue;
+        }
+        if (bad_lines > 0) {
+            cerr << "Warning: Skipped " << bad_lines << " malformed line(s) in " << input_path << endl;
+        }
+        double parsed = omp_get_wtime();
+        if (!writeEdgeListMetis(graph_path, graph) || !writeEdgeListMapping(map_path, graph, format)) {
+            return 1;
+        }
+        double written = omp_get_wtime();
+
+        cout << "Converted " << input_path << " -> " << graph_path << " ("
+             << (weighted ? "weighted" : "unweighted") << ") with " << graph.numNodes()
+             << " nodes and " << graph.num_edges << " edges" << endl;
+        cout << "  read + dedup " << parsed - start << " s, write " << written - parsed
+             << " s, mapping saved to " << map_path << endl;
+        converted++;
+    }
+
+    const IngestStats& ingest = ingestStats();
+    cout << "Text ingest: " << ingest.bytes / 1e6 << " MB in " << ingest.seconds
+         << " s (" << ingest.megabytesPerSecond() << " MB/s)" << endl;
+
+    if (binary) {
+        // The container needs gpmetis's partition of the new .graph files
+        for (const auto& gtype : graph_types) {
+            buildBinaryLayer(gtype, num_parts);
+        }
+    }
+
+    return converted > 0 ? 0 : 1;
+}
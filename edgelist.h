@@ -0,0 +1,368 @@
+#ifndef EDGELIST_H
+#define EDGELIST_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <charconv>
+
+#include "load_graph.h"
+
+using namespace std;
+
+// Native counterpart of weighted_edgelistToGraph.py and
+// unweighted_edgelistToGraph.py: turns a raw Higgs edge list into the METIS
+// .graph file and node mapping those scripts write, byte for byte. Lines are
+// parsed in parallel from the mapped file, and the Python sets are replaced by
+// a counting sort into rows followed by a sort + unique of each row.
+
+// Mapping file layouts. The weighted script writes "<real> <metis>" lines;
+// the social-network script writes a "# METIS_ID ORIGINAL_ID" header, then
+// "<metis> <real>" lines. Both are in ascending ID order.
+enum class MappingFormat { RealToMetis, MetisToReal };
+
+// Deduplicated, symmetric graph over METIS IDs 1..num_nodes (0-based here).
+// With weights, the same pair read with two different weights is kept twice,
+// as two entries of the Python set of (u, v, w) triples; num_edges counts
+// set entries the way the scripts do.
+struct EdgeListGraph {
+    bool weighted = false;
+    vector<int> real_ids;       // METIS node i+1 -> real-world ID, ascending
+    int64_t num_edges = 0;
+    vector<int64_t> offsets;    // rows sorted by (neighbor, weight)
+    vector<Edge> entries;       // 0-based neighbors
+
+    int numNodes() const { return static_cast<int>(real_ids.size()); }
+};
+
+namespace edgelist_detail {
+
+struct RawEdge {
+    int u, v, w;
+};
+
+// Sorts each of about `omp_get_max_threads()` slices in parallel, then merges
+// neighboring slices pairwise until one run is left.
+template <class T>
+void parallelSort(vector<T>& values) {
+    int slices = max(1, min(omp_get_max_threads(), static_cast<int>(values.size() / 4096) + 1));
+    vector<size_t> bounds(slices + 1);
+    for (int s = 0; s <= slices; ++s) bounds[s] = values.size() * s / slices;
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int s = 0; s < slices; ++s) {
+        sort(values.begin() + bounds[s], values.begin() + bounds[s + 1]);
+    }
+    for (int width = 1; width < slices; width *= 2) {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int s = 0; s < slices; s += 2 * width) {
+            if (s + width >= slices) continue;
+            int last = min(s + 2 * width, slices);
+            inplace_merge(values.begin() + bounds[s], values.begin() + bounds[s + width],
+                          values.begin() + bounds[last]);
+        }
+    }
+}
+
+// Real ID -> 0-based METIS ID. IDs are numbered in ascending order, through a
+// dense table when their range is at most a few times the number of edges
+// and by binary search in the sorted ID list otherwise.
+struct IdIndex {
+    int64_t min_id = 0;
+    vector<int> dense;          // id - min_id -> METIS ID, or -1
+    vector<int> sorted_ids;
+
+    int operator()(int id) const {
+        if (!dense.empty()) return dense[static_cast<int64_t>(id) - min_id];
+        return static_cast<int>(lower_bound(sorted_ids.begin(), sorted_ids.end(), id) - sorted_ids.begin());
+    }
+};
+
+inline void buildIdIndex(const vector<vector<RawEdge>>& parts, IdIndex& index, vector<int>& real_ids) {
+    int64_t lo = INT64_MAX, hi = INT64_MIN, total = 0;
+    for (const auto& part : parts) {
+        total += static_cast<int64_t>(part.size());
+        for (const RawEdge& e : part) {
+            lo = min<int64_t>(lo, e.u);
+            hi = max<int64_t>(hi, e.v);
+        }
+    }
+    real_ids.clear();
+    if (total == 0) return;
+    int chunks = static_cast<int>(parts.size());
+
+    if (hi - lo + 1 <= 4 * total + 1024) {
+        vector<char> seen(hi - lo + 1, 0);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < chunks; ++c) {
+            for (const RawEdge& e : parts[c]) {
+                #pragma omp atomic write
+                seen[e.u - lo] = 1;
+                #pragma omp atomic write
+                seen[e.v - lo] = 1;
+            }
+        }
+        index.min_id = lo;
+        index.dense.assign(seen.size(), -1);
+        for (size_t i = 0; i < seen.size(); ++i) {
+            if (seen[i]) {
+                index.dense[i] = static_cast<int>(real_ids.size());
+                real_ids.push_back(static_cast<int>(lo + i));
+            }
+        }
+        return;
+    }
+
+    vector<size_t> first(chunks + 1, 0);
+    for (int c = 0; c < chunks; ++c) first[c + 1] = first[c] + 2 * parts[c].size();
+    real_ids.resize(first[chunks]);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; ++c) {
+        size_t k = first[c];
+        for (const RawEdge& e : parts[c]) {
+            real_ids[k++] = e.u;
+            real_ids[k++] = e.v;
+        }
+    }
+    parallelSort(real_ids);
+    real_ids.erase(unique(real_ids.begin(), real_ids.end()), real_ids.end());
+    real_ids.shrink_to_fit();
+    index.sorted_ids = real_ids;
+}
+
+inline bool entryBefore(const Edge& a, const Edge& b) {
+    return a.neighbor != b.neighbor ? a.neighbor < b.neighbor : a.weight < b.weight;
+}
+
+// Splits a line into its first three whitespace-separated fields, like
+// str.split(). Returns the number of fields seen (capped at 3).
+inline int splitFields(const char* p, const char* end, const char* field[3], const char* field_end[3]) {
+    int count = 0;
+    while (count < 3) {
+        while (p < end && (text_detail::isBlank(*p) || *p == '\f' || *p == '\v')) ++p;
+        if (p == end) break;
+        field[count] = p;
+        while (p < end && !text_detail::isBlank(*p) && *p != '\f' && *p != '\v') ++p;
+        field_end[count++] = p;
+    }
+    return count;
+}
+
+inline bool parseField(const char* begin, const char* end, int& value) {
+    if (begin < end && *begin == '+') ++begin;
+    auto [next, ec] = from_chars(begin, end, value);
+    return ec == errc() && next == end;
+}
+
+// Formats rows [first, last) of the graph into `out` as METIS lines
+inline void formatRows(const EdgeListGraph& g, int first, int last, string& out) {
+    char buf[16];
+    for (int v = first; v < last; ++v) {
+        for (int64_t e = g.offsets[v]; e < g.offsets[v + 1]; ++e) {
+            if (e > g.offsets[v]) out += ' ';
+            out.append(buf, to_chars(buf, buf + sizeof(buf), g.entries[e].neighbor + 1).ptr);
+            if (g.weighted) {
+                out += ' ';
+                out.append(buf, to_chars(buf, buf + sizeof(buf), g.entries[e].weight).ptr);
+            }
+        }
+        out += '\n';
+    }
+}
+
+}
+
+// check_if_weighted(): true if one of the first 100 lines has a third field
+// that parses as an integer.
+bool looksWeighted(const string& path) {
+    ifstream in(path);
+    string line;
+    for (int i = 0; i < 100 && getline(in, line); ++i) {
+        const char* field[3];
+        const char* field_end[3];
+        int value;
+        if (edgelist_detail::splitFields(line.data(), line.data() + line.size(), field, field_end) == 3 &&
+            edgelist_detail::parseField(field[2], field_end[2], value)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reads "u v [w]" lines; blank lines, '#' comments, lines with fewer than two
+// fields and self-loops are skipped, and the weight defaults to 1 (it is only
+// read with `weighted`). Lines whose IDs are not integers are counted in
+// `bad_lines` and skipped. Returns false if the file cannot be opened.
+bool readEdgeList(const string& path, bool weighted, EdgeListGraph& g, int64_t& bad_lines) {
+    using namespace edgelist_detail;
+    double start = omp_get_wtime();
+    MappedFile file(path);
+    if (!file.opened) {
+        cerr << "Error: Cannot open edge list: " << path << endl;
+        return false;
+    }
+    const char* end = file.data + file.size;
+    vector<const char*> bounds = text_detail::lineChunks(file.data, end, omp_get_max_threads() * 4);
+    int chunks = static_cast<int>(bounds.size()) - 1;
+
+    // Canonical (min, max, w) edges of every chunk
+    vector<vector<RawEdge>> parts(max(chunks, 0));
+    vector<int64_t> chunk_bad(max(chunks, 0), 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; ++c) {
+        const char* p = bounds[c];
+        const char* chunk_end = bounds[c + 1];
+        while (p < chunk_end) {
+            const char* line_end = static_cast<const char*>(memchr(p, '\n', chunk_end - p));
+            if (!line_end) line_end = chunk_end;
+            const char* field[3];
+            const char* field_end[3];
+            int fields = *p == '#' ? 0 : splitFields(p, line_end, field, field_end);
+            if (fields >= 2) {
+                int u, v, w = 1;
+                if (!parseField(field[0], field_end[0], u) || !parseField(field[1], field_end[1], v) ||
+                    (weighted && fields == 3 && !parseField(field[2], field_end[2], w))) {
+                    chunk_bad[c]++;
+                } else if (u != v) {
+                    parts[c].push_back({min(u, v), max(u, v), weighted ? w : 1});
+                }
+            }
+            p = line_end < chunk_end ? line_end + 1 : chunk_end;
+        }
+    }
+
+    bad_lines = 0;
+    for (int64_t b : chunk_bad) bad_lines += b;
+
+    g.weighted = weighted;
+    IdIndex index;
+    buildIdIndex(parts, index, g.real_ids);
+    int n = g.numNodes();
+
+    // Both directions of every line, bucketed into rows by a two-pass
+    // counting sort: first into ranges of at most 1024 consecutive-row
+    // buckets, then within each bucket, so the scatters stay in cache. Sorting
+    // and de-duplicating each row then leaves exactly the (neighbor, weight)
+    // pairs of the canonical edge set, so no global sort is needed.
+    int shift = 0;
+    while (n > 0 && ((n - 1) >> shift) >= 1024) shift++;
+    int buckets = n > 0 ? ((n - 1) >> shift) + 1 : 0;
+    vector<int64_t> bucket_count(static_cast<size_t>(chunks) * buckets + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; ++c) {
+        for (RawEdge& e : parts[c]) {
+            e.u = index(e.u);
+            e.v = index(e.v);
+            bucket_count[static_cast<size_t>(e.u >> shift) * chunks + c + 1]++;
+            bucket_count[static_cast<size_t>(e.v >> shift) * chunks + c + 1]++;
+        }
+    }
+    for (size_t i = 1; i < bucket_count.size(); ++i) bucket_count[i] += bucket_count[i - 1];
+    vector<RawEdge> directed(bucket_count.back());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; ++c) {
+        vector<int64_t> slot(buckets);
+        for (int k = 0; k < buckets; ++k) slot[k] = bucket_count[static_cast<size_t>(k) * chunks + c];
+        for (const RawEdge& e : parts[c]) {
+            directed[slot[e.u >> shift]++] = {e.u, e.v, e.w};
+            directed[slot[e.v >> shift]++] = {e.v, e.u, e.w};
+        }
+        vector<RawEdge>().swap(parts[c]);
+    }
+
+    vector<int64_t> raw_offsets(n + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < buckets; ++k) {
+        for (int64_t i = bucket_count[static_cast<size_t>(k) * chunks]; i < bucket_count[static_cast<size_t>(k + 1) * chunks]; ++i) {
+            raw_offsets[directed[i].u + 1]++;
+        }
+    }
+    for (int v = 0; v < n; ++v) raw_offsets[v + 1] += raw_offsets[v];
+    vector<Edge> raw(raw_offsets[n]);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < buckets; ++k) {
+        int first_row = k << shift;
+        int last_row = min(n, (k + 1) << shift);
+        vector<int64_t> fill(raw_offsets.begin() + first_row, raw_offsets.begin() + last_row);
+        for (int64_t i = bucket_count[static_cast<size_t>(k) * chunks]; i < bucket_count[static_cast<size_t>(k + 1) * chunks]; ++i) {
+            const RawEdge& e = directed[i];
+            raw[fill[e.u - first_row]++] = {e.v, e.w};
+        }
+    }
+    vector<RawEdge>().swap(directed);
+
+    vector<int64_t> row_length(n + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < n; ++v) {
+        auto row_begin = raw.begin() + raw_offsets[v];
+        auto row_end = raw.begin() + raw_offsets[v + 1];
+        sort(row_begin, row_end, entryBefore);
+        row_length[v + 1] = unique(row_begin, row_end, [](const Edge& a, const Edge& b) {
+            return a.neighbor == b.neighbor && a.weight == b.weight;
+        }) - row_begin;
+    }
+    for (int v = 0; v < n; ++v) row_length[v + 1] += row_length[v];
+    g.offsets = move(row_length);
+    g.entries.resize(g.offsets[n]);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < n; ++v) {
+        copy(raw.begin() + raw_offsets[v], raw.begin() + raw_offsets[v] + (g.offsets[v + 1] - g.offsets[v]),
+             g.entries.begin() + g.offsets[v]);
+    }
+    g.num_edges = g.offsets[n] / 2;
+
+    ingestStats().add(file.size, omp_get_wtime() - start);
+    return true;
+}
+
+// Writes "<nodes> <edges>[ 1]" and one line per node. Blocks of rows with
+// about equal entry counts are formatted in parallel and written in order.
+bool writeEdgeListMetis(const string& path, const EdgeListGraph& g) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        cerr << "Error: Cannot write graph file: " << path << endl;
+        return false;
+    }
+    out << g.numNodes() << " " << g.num_edges << (g.weighted ? " 1" : "") << "\n";
+
+    int n = g.numNodes();
+    int blocks = omp_get_max_threads() * 4;
+    vector<int> row_bounds(blocks + 1, n);
+    row_bounds[0] = 0;
+    for (int b = 1; b < blocks; ++b) {
+        int64_t target = g.offsets[n] * b / blocks;
+        row_bounds[b] = static_cast<int>(lower_bound(g.offsets.begin(), g.offsets.end(), target) - g.offsets.begin());
+        row_bounds[b] = max(row_bounds[b - 1], min(row_bounds[b], n));
+    }
+    vector<string> text(blocks);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < blocks; ++b) {
+        edgelist_detail::formatRows(g, row_bounds[b], row_bounds[b + 1], text[b]);
+    }
+    for (const string& t : text) out.write(t.data(), t.size());
+    return static_cast<bool>(out);
+}
+
+bool writeEdgeListMapping(const string& path, const EdgeListGraph& g, MappingFormat format) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        cerr << "Error: Cannot write mapping file: " << path << endl;
+        return false;
+    }
+    string text;
+    if (format == MappingFormat::MetisToReal) text = "# METIS_ID ORIGINAL_ID\n";
+    char buf[16];
+    for (int i = 0; i < g.numNodes(); ++i) {
+        int first = format == MappingFormat::RealToMetis ? g.real_ids[i] : i + 1;
+        int second = format == MappingFormat::RealToMetis ? i + 1 : g.real_ids[i];
+        text.append(buf, to_chars(buf, buf + sizeof(buf), first).ptr);
+        text += ' ';
+        text.append(buf, to_chars(buf, buf + sizeof(buf), second).ptr);
+        text += '\n';
+    }
+    out.write(text.data(), text.size());
+    return static_cast<bool>(out);
+}
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "load_graph.h"
+#include "Influence.h"
+#include "Top-k.h"
+
+using namespace std;
+
+// One layer kept in a form that absorbs edge inserts and deletes. Every
+// vertex owns a sorted neighbor list with the weight and the cached Jaccard
+// of each edge, so a batch only touches the lists of the vertices it changes.
+// Vertices are identified by real-world ID; new IDs are appended.
+struct DynamicGraph {
+    vector<int> vertex_ids;             // index -> real-world ID
+    vector<int> index_of;               // real-world ID -> index, -1 if absent
+    vector<vector<int>> rows;           // neighbor indices, ascending
+    vector<vector<int>> row_weights;    // parallel to rows
+    vector<vector<double>> row_jaccard; // parallel to rows
+    vector<double> scores;
+    vector<pair<int, double>> topK;     // (real-world ID, score), best first
+    int k = 0;
+
+    int numVertices() const { return static_cast<int>(vertex_ids.size()); }
+};
+
+// A single change: `insert` adds `weight` to edge (u, v), creating it if
+// needed; otherwise the edge is removed. IDs are real-world IDs.
+struct EdgeUpdate {
+    bool insert;
+    int u, v;
+    int weight;
+};
+
+struct UpdateStats {
+    int changed = 0;        // vertices whose neighbor set changed
+    int rescored = 0;       // vertices whose score was recomputed
+    long long jaccards = 0; // edge Jaccards recomputed
+    bool full_topk = false; // top-K had to be rebuilt from all scores
+};
+
+// Jaccard of edge (u, x) from the current rows.
+inline double dynamicJaccard(const DynamicGraph& g, int u, int x) {
+    const vector<int>& ru = g.rows[u];
+    const vector<int>& rx = g.rows[x];
+    int intersection = intersectionCount(ru.data(), static_cast<int>(ru.size()),
+                                         rx.data(), static_cast<int>(rx.size()));
+    return edgeJaccard(intersection, static_cast<int>(ru.size()), static_cast<int>(rx.size()));
+}
+
+// Sums the row of u in edge order, as scoreEdges does.
+inline double dynamicScore(const DynamicGraph& g, int u) {
+    double score = 0.0;
+    for (size_t i = 0; i < g.rows[u].size(); i++) {
+        score += g.row_weights[u][i] * g.row_jaccard[u][i];
+    }
+    return score;
+}
+
+// Recomputes every Jaccard, score and the top-K from scratch.
+void rescoreAll(DynamicGraph& g) {
+    int n = g.numVertices();
+    g.scores.assign(n, 0.0);
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int u = 0; u < n; u++) {
+        for (size_t i = 0; i < g.rows[u].size(); i++) {
+            g.row_jaccard[u][i] = dynamicJaccard(g, u, g.rows[u][i]);
+        }
+        g.scores[u] = dynamicScore(g, u);
+    }
+    g.topK = selectTopK(g.scores, HeapTopK(g.k), [&](int v) { return g.vertex_ids[v]; });
+}
+
+// Builds the dynamic form of a whole-graph layer (one CSRGraph holding every
+// vertex, METIS IDs in vertex_ids) and scores it. Neighbors without a row of
+// their own become vertices with an empty row, as in a halo of degree zero.
+DynamicGraph buildDynamicGraph(const CSRGraph& graph, const vector<int>& mapping, int k) {
+    DynamicGraph g;
+    g.k = k;
+    int n = graph.numVertices();
+    g.vertex_ids.resize(n);
+    int max_real = 0;
+    for (int v = 0; v < n; ++v) {
+        g.vertex_ids[v] = realNodeId(mapping, graph.vertex_ids[v]);
+        max_real = max(max_real, g.vertex_ids[v]);
+    }
+    g.index_of.assign(max_real + 1, -1);
+    for (int v = 0; v < n; ++v) {
+        g.index_of[g.vertex_ids[v]] = v;
+    }
+
+    g.rows.resize(n);
+    g.row_weights.resize(n);
+    g.row_jaccard.resize(n);
+    for (int v = 0; v < graph.num_local; ++v) {
+        g.rows[v].assign(graph.row(v), graph.row(v) + graph.degree(v));
+        g.row_weights[v].assign(graph.rowWeights(v), graph.rowWeights(v) + graph.degree(v));
+        g.row_jaccard[v].assign(graph.degree(v), 0.0);
+    }
+    rescoreAll(g);
+    return g;
+}
+
+// CSR copy of the current graph with every vertex local, for checking the
+// maintained scores against the regular kernels.
+CSRGraph toCSR(const DynamicGraph& g) {
+    CSRGraph csr;
+    int n = g.numVertices();
+    csr.num_local = n;
+    csr.vertex_ids = g.vertex_ids;
+    csr.offsets.assign(n + 1, 0);
+    for (int u = 0; u < n; ++u) {
+        csr.offsets[u + 1] = csr.offsets[u] + static_cast<int64_t>(g.rows[u].size());
+        csr.neighbors.insert(csr.neighbors.end(), g.rows[u].begin(), g.rows[u].end());
+        csr.weights.insert(csr.weights.end(), g.row_weights[u].begin(), g.row_weights[u].end());
+    }
+    return csr;
+}
+
+namespace incremental_detail {
+
+inline int vertexIndex(DynamicGraph& g, int id) {
+    if (id >= static_cast<int>(g.index_of.size())) {
+        g.index_of.resize(max<size_t>(id + 1, g.index_of.size() * 2), -1);
+    }
+    if (g.index_of[id] < 0) {
+        g.index_of[id] = g.numVertices();
+        g.vertex_ids.push_back(id);
+        g.rows.emplace_back();
+        g.row_weights.emplace_back();
+        g.row_jaccard.emplace_back();
+        g.scores.push_back(0.0);
+    }
+    return g.index_of[id];
+}
+
+// Applies one direction of an update to the row of u. Returns 1 if the
+// neighbor set changed, 0 if only the weight did and -1 if nothing did.
+inline int applyToRow(DynamicGraph& g, int u, int v, bool insert, int weight) {
+    vector<int>& row = g.rows[u];
+    auto it = lower_bound(row.begin(), row.end(), v);
+    size_t i = it - row.begin();
+    bool present = it != row.end() && *it == v;
+
+    if (insert) {
+        if (present) {
+            g.row_weights[u][i] += weight;
+            return 0;
+        }
+        row.insert(it, v);
+        g.row_weights[u].insert(g.row_weights[u].begin() + i, weight);
+        g.row_jaccard[u].insert(g.row_jaccard[u].begin() + i, 0.0);
+        return 1;
+    }
+    if (!present) return -1;
+    row.erase(it);
+    g.row_weights[u].erase(g.row_weights[u].begin() + i);
+    g.row_jaccard[u].erase(g.row_jaccard[u].begin() + i);
+    return 1;
+}
+
+}
+
+// Applies a batch of updates in both directions and brings the cached
+// Jaccards, the scores and the top-K up to date. Only edges incident to a
+// vertex whose neighbor set changed get a new Jaccard, and only those
+// vertices, their neighbors and vertices whose edge weights changed are
+// re-summed. Rows are summed in edge order, so the result equals a full
+// recompute bit for bit.
+UpdateStats applyEdgeBatch(DynamicGraph& g, const vector<EdgeUpdate>& batch) {
+    using namespace incremental_detail;
+    UpdateStats stats;
+    vector<pair<int, double>> old_top = g.topK;
+
+    vector<char> changed, reweighted;
+    vector<int> changed_list;
+    for (const EdgeUpdate& up : batch) {
+        if (up.u < 0 || up.v < 0) continue;
+        int u = vertexIndex(g, up.u), v = vertexIndex(g, up.v);
+        changed.resize(g.numVertices(), 0);
+        reweighted.resize(g.numVertices(), 0);
+
+        int ends[2] = {u, v};
+        for (int side = 0; side < (u == v ? 1 : 2); ++side) {
+            int a = ends[side], b = ends[1 - side];
+            int effect = applyToRow(g, a, b, up.insert, up.weight);
+            if (effect == 1 && !changed[a]) {
+                changed[a] = 1;
+                changed_list.push_back(a);
+            } else if (effect == 0) {
+                reweighted[a] = 1;
+            }
+        }
+    }
+    int n = g.numVertices();
+    changed.resize(n, 0);
+    reweighted.resize(n, 0);
+    stats.changed = static_cast<int>(changed_list.size());
+
+    // A changed vertex refreshes its own row and the reverse slot in each
+    // unchanged neighbor's row, so every slot has exactly one writer
+    long long jaccards = 0;
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+:jaccards)
+    for (size_t c = 0; c < changed_list.size(); c++) {
+        int u = changed_list[c];
+        for (size_t i = 0; i < g.rows[u].size(); i++) {
+            int x = g.rows[u][i];
+            double jaccard = dynamicJaccard(g, u, x);
+            g.row_jaccard[u][i] = jaccard;
+            jaccards++;
+            if (changed[x]) continue;
+            vector<int>& rx = g.rows[x];
+            size_t j = lower_bound(rx.begin(), rx.end(), u) - rx.begin();
+            g.row_jaccard[x][j] = jaccard;
+        }
+    }
+    stats.jaccards = jaccards;
+
+    // Vertices whose score can have moved
+    vector<char> dirty(n, 0);
+    vector<int> dirty_list;
+    auto mark = [&](int v) {
+        if (!dirty[v]) {
+            dirty[v] = 1;
+            dirty_list.push_back(v);
+        }
+    };
+    for (int u : changed_list) {
+        mark(u);
+        for (int x : g.rows[u]) mark(x);
+    }
+    for (int v = 0; v < n; ++v) {
+        if (reweighted[v]) mark(v);
+    }
+    stats.rescored = static_cast<int>(dirty_list.size());
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t d = 0; d < dirty_list.size(); d++) {
+        int v = dirty_list[d];
+        g.scores[v] = dynamicScore(g, v);
+    }
+
+    // The old top-K minus its dirty members, plus every dirty vertex, holds
+    // the new top-K unless a member dropped; then an untouched vertex may
+    // move up and all scores are scanned again
+    bool member_dropped = false;
+    vector<char> dirty_member(old_top.size(), 0);
+    for (size_t t = 0; t < old_top.size(); ++t) {
+        int v = g.index_of[old_top[t].first];
+        if (!dirty[v]) continue;
+        dirty_member[t] = 1;
+        if (rankedBefore(old_top[t], {old_top[t].first, g.scores[v]})) member_dropped = true;
+    }
+
+    if (member_dropped) {
+        g.topK = selectTopK(g.scores, HeapTopK(g.k), [&](int v) { return g.vertex_ids[v]; });
+        stats.full_topk = true;
+    } else {
+        HeapTopK best(g.k);
+        for (size_t t = 0; t < old_top.size(); ++t) {
+            if (!dirty_member[t]) best.offer(old_top[t].first, old_top[t].second);
+        }
+        for (int v : dirty_list) best.offer(g.vertex_ids[v], g.scores[v]);
+        g.topK = best.result();
+    }
+    return stats;
+}
+
+// Reads "+ u v [w]" (insert, weight 1 by default) and "- u v" (delete) lines.
+vector<EdgeUpdate> loadEdgeUpdates(const string& update_file) {
+    vector<EdgeUpdate> batch;
+    ifstream in(update_file);
+    if (!in) {
+        cerr << "Error: Cannot open update file: " << update_file << endl;
+        return batch;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        istringstream iss(line);
+        string op;
+        EdgeUpdate up = {true, -1, -1, 1};
+        if (!(iss >> op >> up.u >> up.v) || (op != "+" && op != "-")) {
+            if (!op.empty() && op[0] != '#') {
+                cerr << "Warning: Skipping malformed update: " << line << endl;
+            }
+            continue;
+        }
+        up.insert = op == "+";
+        if (up.insert) iss >> up.weight;
+        batch.push_back(up);
+    }
+    return batch;
+}
+
+#endif
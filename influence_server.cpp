@@ -0,0 +1,149 @@
+// g++ -std=c++17 -O2 -fopenmp -pthread -o influence_server influence_server.cpp
+// ./influence_server [--parts N] [--omp-schedule static|dynamic|degree]
+//                    [--top-k K] [--weights m,rt,rp,s] [--cache-dir DIR] [--no-cache]
+//                    [--socket PATH]
+//
+// Loads and scores the four layers once, then answers top-K queries until
+// stdin closes (or, with --socket, over a Unix socket with one thread per
+// client). See handleRequest in query_server.h for the protocol, e.g.
+//
+//   top k=20 weights=1,1,0,0
+//   top layer=retweet users=88,677,220
+//   score 88,677
+//   reload
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "load_graph.h"
+#include "query_server.h"
+
+using namespace std;
+
+// Writes all of `text` to the socket. Returns false once the client is gone.
+bool sendAll(int fd, const string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Serves one socket client until it quits or disconnects.
+void serveClient(InfluenceServer& server, int fd) {
+    string pending;
+    char buffer[4096];
+    bool open = true;
+    while (open) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        pending.append(buffer, n);
+        size_t start = 0, newline;
+        while (open && (newline = pending.find('\n', start)) != string::npos) {
+            string line = pending.substr(start, newline - start);
+            start = newline + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            ostringstream reply;
+            open = handleRequest(server, line, reply, cerr);
+            open = sendAll(fd, reply.str()) && open;
+        }
+        pending.erase(0, start);
+    }
+    close(fd);
+}
+
+int serveSocket(InfluenceServer& server, const string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: Socket path too long: " << path << endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listener, 64) < 0) {
+        cerr << "Error: Cannot listen on " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    cerr << "Listening on " << path << endl;
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Error: accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        thread(serveClient, ref(server), fd).detach();
+    }
+    close(listener);
+    unlink(path.c_str());
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    // --parts, --omp-schedule, --cache-dir and --no-cache pick the scores as
+    // in serialVersion (whose cache entries are reused). --top-k and
+    // --weights are the defaults of a "top" query without k= or weights=.
+    // --socket PATH serves a Unix socket instead of stdin.
+    InfluenceServer server;
+    string socket_path;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--parts" && i + 1 < argc) {
+            server.config.num_parts = atoi(argv[++i]);
+        } else if (arg == "--omp-schedule" && i + 1 < argc) {
+            server.config.options.schedule = parseKernelSchedule(argv[++i]);
+        } else if (arg == "--top-k" && i + 1 < argc) {
+            server.default_k = atoi(argv[++i]);
+        } else if (arg == "--weights" && i + 1 < argc) {
+            if (!parseLayerWeights(argv[++i], server.default_weights)) {
+                cerr << "--weights needs " << graph_types.size() << " comma-separated values" << endl;
+                return 1;
+            }
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            server.config.cache_dir = argv[++i];
+        } else if (arg == "--no-cache") {
+            server.config.use_cache = false;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [--parts N] [--omp-schedule static|dynamic|degree]"
+                 << " [--top-k K] [--weights m,rt,rp,s] [--cache-dir DIR] [--no-cache]"
+                 << " [--socket PATH]" << endl;
+            return 1;
+        }
+    }
+    if (server.config.num_parts < 1 || server.default_k < 1) {
+        cerr << "--parts and --top-k must be at least 1" << endl;
+        return 1;
+    }
+
+    ostringstream reply;
+    answerReload(server, reply, cerr);
+    cerr << reply.str();
+    if (!currentSnapshot(server)) return 1;
+
+    if (!socket_path.empty()) return serveSocket(server, socket_path);
+
+    string line;
+    while (getline(cin, line)) {
+        if (!handleRequest(server, line, cout, cerr)) break;
+        cout.flush();
+    }
+    return 0;
+}
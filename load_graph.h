@@ -9,148 +9,773 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+// Serial stand-ins so everything still builds without -fopenmp
+inline int omp_get_max_threads() { return 1; }
+inline int omp_get_thread_num() { return 0; }
+inline void omp_set_num_threads(int) {}
+inline double omp_get_wtime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
 
 using namespace std;
 
 const vector<string> graph_types = {"mention", "retweet", "reply", "social"};
 const int NUM_PARTS = 8;
 
+// Weight of each layer in the combined score, in graph_types order
+const vector<double> LAYER_WEIGHTS = {0.3, 0.5, 0.4, 0.01};
+
+// Parses a comma-separated list with one weight per layer, e.g. the
+// defaults as "0.3,0.5,0.4,0.01". Returns false on a malformed list.
+inline bool parseLayerWeights(const string& list, vector<double>& weights) {
+    vector<double> parsed;
+    const char* p = list.c_str();
+    while (*p) {
+        char* end;
+        double w = strtod(p, &end);
+        if (end == p || (*end != ',' && *end != '\0')) return false;
+        parsed.push_back(w);
+        p = *end == ',' ? end + 1 : end;
+    }
+    if (parsed.size() != graph_types.size()) return false;
+    weights = parsed;
+    return true;
+}
+
 struct Edge {
     int neighbor;
     int weight;
 };
 
-void printSubgraph(int part_id, const unordered_map<int, vector<Edge>>& subgraph) {
+// Compressed-sparse-row view of one partition.
+// Vertices owned by the partition get dense local IDs [0, num_local) in METIS
+// order; neighbors owned by other partitions are appended after them as ghost
+// vertices [num_local, vertex_ids.size()) whose rows live in the halo, if any.
+// Every row is sorted by local ID with duplicate edges merged (weights summed),
+// so a row is exactly the neighbor set of the vertex.
+struct CSRGraph {
+    int num_local = 0;
+    vector<int> vertex_ids;     // local ID -> METIS node ID (locals, then ghosts)
+    vector<int64_t> offsets;    // row pointers, size num_local + 1
+    vector<int> neighbors;      // local IDs of neighbors, sorted per row
+    vector<int> weights;        // parallel to neighbors
+
+    // Halo: rows of ghost vertices fetched from their owners, restricted to IDs
+    // present in this graph, plus each ghost's full degree. Empty until set.
+    vector<int64_t> halo_offsets;   // size numGhosts() + 1
+    vector<int> halo_neighbors;     // local IDs, sorted per ghost row
+    vector<int> halo_degrees;       // full degree of each ghost
+
+    int numVertices() const { return static_cast<int>(vertex_ids.size()); }
+    int64_t numEdges() const { return static_cast<int64_t>(neighbors.size()); }
+    bool isLocal(int v) const { return v < num_local; }
+    int degree(int v) const { return static_cast<int>(offsets[v + 1] - offsets[v]); }
+    const int* row(int v) const { return neighbors.data() + offsets[v]; }
+    const int* rowWeights(int v) const { return weights.data() + offsets[v]; }
+    int numGhosts() const { return numVertices() - num_local; }
+    bool hasHalo() const { return !halo_offsets.empty(); }
+};
+
+void printSubgraph(int part_id, const CSRGraph& subgraph) {
     cout << "\n--- Subgraph " << part_id << " ---" << endl;
-    for (const auto& [node, edges] : subgraph) {
-        cout << "Node " << node << " -> ";
-        for (const auto& edge : edges) {
-            cout << "(" << edge.neighbor << ", w=" << edge.weight << ") ";
+    for (int v = 0; v < subgraph.num_local; ++v) {
+        cout << "Node " << subgraph.vertex_ids[v] << " -> ";
+        for (int64_t e = subgraph.offsets[v]; e < subgraph.offsets[v + 1]; ++e) {
+            cout << "(" << subgraph.vertex_ids[subgraph.neighbors[e]]
+                 << ", w=" << subgraph.weights[e] << ") ";
         }
         cout << endl;
     }
 }
 
-void loadGraph(const string& graph_file,
-               const string& part_file,
-               const string& mapping_file,
-               vector<unordered_map<int, vector<Edge>>>& subgraphs,
-               bool use_mapping) {
-    
-    // Load partition file
-    vector<int> node_to_partition;
-    {
-        ifstream in(part_file);
-        if (!in) {
-            cerr << "Error: Cannot open partition file: " << part_file << endl;
-            return;
+// Sorts a row of edges by neighbor and merges duplicates by summing weights.
+void canonicalizeRow(vector<Edge>& row) {
+    sort(row.begin(), row.end(), [](const Edge& a, const Edge& b) {
+        return a.neighbor < b.neighbor;
+    });
+    size_t out = 0;
+    for (size_t i = 0; i < row.size(); ++i) {
+        if (out > 0 && row[out - 1].neighbor == row[i].neighbor) {
+            row[out - 1].weight += row[i].weight;
+        } else {
+            row[out++] = row[i];
         }
-        
-        int p;
-        while (in >> p) {
-            if (p < 0 || p >= NUM_PARTS) {
-                cerr << "Warning: Invalid partition " << p << " (should be 0-" << (NUM_PARTS-1) << ")" << endl;
-                p = 0; // Default to partition 0 if invalid
+    }
+    row.resize(out);
+}
+
+// Turns the rows collected for one partition (keyed by METIS ID) into a
+// CSRGraph with dense local IDs. `slot` is a scratch array indexed by METIS ID
+// that must be all -1 on entry; it is restored before returning.
+void buildCSR(const vector<int>& row_ids,
+              const vector<int64_t>& row_offsets,
+              const vector<Edge>& row_edges,
+              vector<int>& slot,
+              CSRGraph& graph) {
+    graph = CSRGraph();
+    graph.num_local = static_cast<int>(row_ids.size());
+    graph.vertex_ids = row_ids;
+    for (int v = 0; v < graph.num_local; ++v) {
+        slot[row_ids[v]] = v;
+    }
+
+    // Ghosts are numbered in ascending METIS order after the local vertices
+    vector<int> ghosts;
+    for (const auto& e : row_edges) {
+        if (slot[e.neighbor] < 0) {
+            ghosts.push_back(e.neighbor);
+        }
+    }
+    sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(unique(ghosts.begin(), ghosts.end()), ghosts.end());
+    for (int g : ghosts) {
+        slot[g] = static_cast<int>(graph.vertex_ids.size());
+        graph.vertex_ids.push_back(g);
+    }
+
+    graph.offsets.assign(graph.num_local + 1, 0);
+    graph.neighbors.resize(row_edges.size());
+    graph.weights.resize(row_edges.size());
+
+    vector<pair<int, int>> row;
+    for (int v = 0; v < graph.num_local; ++v) {
+        row.clear();
+        for (int64_t e = row_offsets[v]; e < row_offsets[v + 1]; ++e) {
+            row.emplace_back(slot[row_edges[e].neighbor], row_edges[e].weight);
+        }
+        // METIS order and local order only differ once ghosts are involved
+        sort(row.begin(), row.end());
+        int64_t base = row_offsets[v];
+        for (size_t i = 0; i < row.size(); ++i) {
+            graph.neighbors[base + i] = row[i].first;
+            graph.weights[base + i] = row[i].second;
+        }
+        graph.offsets[v + 1] = row_offsets[v + 1];
+    }
+
+    for (int id : graph.vertex_ids) {
+        slot[id] = -1;
+    }
+}
+
+// Read-only mapping of a whole file; unmapped on destruction.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;        // the file exists and could be mapped (or is empty)
+
+    explicit MappedFile(const string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            opened = st.st_size == 0;
+            if (st.st_size > 0) {
+                void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    data = static_cast<const char*>(p);
+                    size = static_cast<size_t>(st.st_size);
+                    opened = true;
+                    madvise(p, size, MADV_SEQUENTIAL);
+                }
             }
-            node_to_partition.push_back(p);
         }
-        
-//        cout << "Loaded " << node_to_partition.size() << " partition assignments from " << part_file << endl;
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+// Bytes and time spent parsing text input, summed over every load so the
+// drivers can report ingest throughput.
+struct IngestStats {
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    mutex lock;  // files may be parsed from more than one thread
+
+    void add(uint64_t file_bytes, double file_seconds) {
+        lock_guard<mutex> guard(lock);
+        bytes += file_bytes;
+        seconds += file_seconds;
+    }
+
+    double megabytesPerSecond() const { return seconds > 0.0 ? bytes / 1e6 / seconds : 0.0; }
+};
+
+inline IngestStats& ingestStats() {
+    static IngestStats stats;
+    return stats;
+}
+
+namespace text_detail {
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parses the next integer of [p, end) into `value`, skipping blanks but not
+// newlines. Returns false at the end of the line or on a non-number.
+inline bool nextInt(const char*& p, const char* end, int& value) {
+    while (p < end && isBlank(*p)) ++p;
+    if (p == end || *p == '\n') return false;
+    auto [next, ec] = from_chars(p, end, value);
+    if (ec != errc()) return false;
+    p = next;
+    return true;
+}
+
+// Splits [begin, end) into about `count` pieces that each start at a line start.
+inline vector<const char*> lineChunks(const char* begin, const char* end, int count) {
+    vector<const char*> bounds(1, begin);
+    size_t step = max<size_t>(1, (end - begin) / max(1, count));
+    const char* p = begin;
+    while (end - p > static_cast<ptrdiff_t>(step)) {
+        const char* nl = static_cast<const char*>(memchr(p + step, '\n', end - p - step));
+        if (!nl) break;
+        p = nl + 1;
+        bounds.push_back(p);
     }
+    if (bounds.back() != end) bounds.push_back(end);
+    return bounds;
+}
 
-   
-    // Maps metis node ID to original node ID
-    unordered_map<int, int> metis_to_original;
-    if (use_mapping) {
-        ifstream in(mapping_file);
-        if (!in) {
-            cerr << "Error: Cannot open mapping file: " << mapping_file << endl;
-            return;
+// Every integer of a whitespace-separated text file, in file order. Chunks
+// are parsed in parallel and concatenated by prefix sum.
+inline bool parseIntFile(const string& path, vector<int>& values) {
+    double start = omp_get_wtime();
+    MappedFile file(path);
+    if (!file.opened) return false;
+    const char* end = file.data + file.size;
+    vector<const char*> bounds = lineChunks(file.data, end, omp_get_max_threads() * 4);
+    int chunks = static_cast<int>(bounds.size()) - 1;
+
+    vector<vector<int>> parts(max(chunks, 0));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; ++c) {
+        const char* p = bounds[c];
+        const char* chunk_end = bounds[c + 1];
+        int value;
+        while (p < chunk_end) {
+            if (nextInt(p, chunk_end, value)) {
+                parts[c].push_back(value);
+            } else if (p < chunk_end && *p == '\n') {
+                ++p;
+            } else if (p < chunk_end) {
+                break;      // like operator>>, stop at the first non-number
+            }
         }
-        
-        int orig, metis;
-        while (in >> orig >> metis) {
-            metis_to_original[metis] = orig;
+    }
+
+    vector<size_t> first(chunks + 1, 0);
+    for (int c = 0; c < chunks; ++c) first[c + 1] = first[c] + parts[c].size();
+    values.resize(first[chunks]);
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < chunks; ++c) {
+        copy(parts[c].begin(), parts[c].end(), values.begin() + first[c]);
+    }
+
+    ingestStats().add(file.size, omp_get_wtime() - start);
+    return true;
+}
+
+}
+
+// Rows parsed from a METIS graph file for one group of nodes, in node order.
+struct ParsedRows {
+    vector<int> row_ids;                    // METIS node IDs
+    vector<int64_t> row_offsets = {0};
+    vector<Edge> row_edges;                 // canonical rows (sorted, merged)
+};
+
+// Byte offset of every adjacency line of a METIS graph file: the line of node
+// i spans [starts[i - 1], starts[i]). Lets repeated loads of a few partitions
+// or ghost rows parse only their own lines instead of scanning the file.
+struct MetisLineIndex {
+    vector<int64_t> starts;     // one per line, plus the end of the file
+    uint64_t file_size = 0;     // size of the file it was built from
+
+    bool empty() const { return starts.empty(); }
+    int numLines() const { return starts.empty() ? 0 : static_cast<int>(starts.size()) - 1; }
+};
+
+// Builds the index with one parallel pass over the file. Lines are counted as
+// parseMetisRows counts them. Returns false if the file cannot be opened.
+bool buildLineIndex(const string& graph_file, MetisLineIndex& index) {
+    using namespace text_detail;
+    double start = omp_get_wtime();
+    MappedFile file(graph_file);
+    if (!file.opened) {
+        return false;
+    }
+    const char* begin = file.data;
+    const char* end = file.data + file.size;
+    const char* nl = begin ? static_cast<const char*>(memchr(begin, '\n', file.size)) : nullptr;
+    const char* body = nl ? nl + 1 : end;
+
+    vector<const char*> bounds = lineChunks(body, end, omp_get_max_threads() * 4);
+    int chunks = static_cast<int>(bounds.size()) - 1;
+    vector<vector<int64_t>> local(max(chunks, 0));
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < chunks; ++c) {
+        const char* q = bounds[c];
+        while (q < bounds[c + 1]) {
+            local[c].push_back(q - begin);
+            const char* line_end = static_cast<const char*>(memchr(q, '\n', bounds[c + 1] - q));
+            q = line_end ? line_end + 1 : bounds[c + 1];
         }
-//        cout << "Loaded " << metis_to_original.size() << " mappings from " << mapping_file << endl;
     }
 
-    // Load graph
-    ifstream infile(graph_file);
-    if (!infile) {
-        cerr << "Error: Cannot open graph file: " << graph_file << endl;
-        return;
+    index.starts.clear();
+    for (const auto& starts : local) index.starts.insert(index.starts.end(), starts.begin(), starts.end());
+    index.starts.push_back(static_cast<int64_t>(file.size));
+    index.file_size = file.size;
+    ingestStats().add(file.size, omp_get_wtime() - start);
+    return true;
+}
+
+// Parses the adjacency lines of a METIS graph file in parallel. The mapped
+// file is split into line-aligned chunks; a first pass counts the lines of
+// every chunk so each knows the node ID it starts at, a second pass parses
+// the lines with from_chars into per-chunk rows, and the rows of every group
+// are then concatenated in node order by prefix sum. group_of(node) returns
+// the group of a node (or -1 to skip it); nodes without edges are dropped.
+// With `weighted`, entries are (neighbor, weight) pairs, otherwise weights
+// are 1. With a line index of the same file, only the lines of selected
+// nodes are read, split into runs of equal line count. Returns false if the
+// file cannot be opened.
+template <class GroupOf>
+bool parseMetisRows(const string& graph_file, bool weighted, int num_groups,
+                    GroupOf group_of, vector<ParsedRows>& groups,
+                    int& total_nodes, int& max_id, int& num_lines,
+                    const MetisLineIndex* index = nullptr) {
+    using namespace text_detail;
+    double start = omp_get_wtime();
+    MappedFile file(graph_file);
+    if (!file.opened) {
+        return false;
     }
-    
-    string line;
-    
+    const char* begin = file.data;
+    const char* end = file.data + file.size;
+
     // Parse the first line (metadata)
-    getline(infile, line);
-    istringstream meta(line);
-    int total_nodes, total_edges;
-    meta >> total_nodes >> total_edges;
-//    cout << "Graph has " << total_nodes << " nodes and " << total_edges << " edges" << endl;
-    
-    // Process each node's adjacency list
-    int node_id = 0;
-    while (getline(infile, line)) {
-        node_id++; // 1-based node ID in the .graph file
-        
-        // Skip if we don't have partition information for this node
-        if (node_id > node_to_partition.size()) {
-            cerr << "Warning: No partition info for node " << node_id << ", skipping" << endl;
+    total_nodes = 0;
+    int total_edges = 0;
+    const char* p = begin;
+    nextInt(p, end, total_nodes);
+    nextInt(p, end, total_edges);
+    const char* nl = begin ? static_cast<const char*>(memchr(begin, '\n', file.size)) : nullptr;
+    const char* body = nl ? nl + 1 : end;
+    if (index && index->file_size != file.size) {
+        cerr << "Warning: Line index does not match " << graph_file << ", scanning the file" << endl;
+        index = nullptr;
+    }
+    if (index && file.data) {
+        // Selected lines are scattered, so drop the sequential read-ahead
+        madvise(const_cast<char*>(file.data), file.size, MADV_NORMAL);
+    }
+
+    int chunks = 0;
+    vector<const char*> bounds;
+    vector<int> first_node, selected, selected_bounds;
+    if (!index) {
+        bounds = lineChunks(body, end, omp_get_max_threads() * 4);
+        chunks = static_cast<int>(bounds.size()) - 1;
+
+        // Pass 1: lines per chunk; a last line without a newline still counts
+        first_node.assign(chunks + 1, 0);
+        #pragma omp parallel for schedule(static)
+        for (int c = 0; c < chunks; ++c) {
+            int lines = static_cast<int>(count(bounds[c], bounds[c + 1], '\n'));
+            if (bounds[c + 1] == end && bounds[c + 1] > bounds[c] && end[-1] != '\n') lines++;
+            first_node[c + 1] = lines;
+        }
+        for (int c = 0; c < chunks; ++c) first_node[c + 1] += first_node[c];
+        num_lines = chunks > 0 ? first_node[chunks] : 0;
+    } else {
+        // The index replaces pass 1: select the wanted lines up front
+        num_lines = index->numLines();
+        for (int node_id = 1; node_id <= num_lines; ++node_id) {
+            if (group_of(node_id) >= 0) selected.push_back(node_id);
+        }
+        int num_selected = static_cast<int>(selected.size());
+        chunks = min(num_selected, omp_get_max_threads() * 4);
+        for (int c = 0; c <= chunks; ++c) {
+            selected_bounds.push_back(static_cast<int>(static_cast<int64_t>(num_selected) * c / max(chunks, 1)));
+        }
+    }
+
+    // Pass 2: parse rows into per-chunk, per-group buffers
+    vector<vector<ParsedRows>> local(max(chunks, 0), vector<ParsedRows>(num_groups));
+    vector<int> chunk_max(max(chunks, 0), 0);
+    vector<uint64_t> chunk_bytes(max(chunks, 0), 0);
+    auto parseLine = [&](const char* q, const char* line_end, int node_id, int c, vector<Edge>& row) {
+        int group = group_of(node_id);
+        if (group < 0) return;
+        row.clear();
+        int neighbor, weight;
+        while (nextInt(q, line_end, neighbor)) {
+            weight = 1;
+            if (weighted && !nextInt(q, line_end, weight)) weight = 1;
+            row.push_back({neighbor, weight});
+            chunk_max[c] = max(chunk_max[c], neighbor);
+        }
+        if (!row.empty()) {
+            canonicalizeRow(row);
+            ParsedRows& out = local[c][group];
+            out.row_ids.push_back(node_id);
+            out.row_edges.insert(out.row_edges.end(), row.begin(), row.end());
+            out.row_offsets.push_back(static_cast<int64_t>(out.row_edges.size()));
+        }
+    };
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; ++c) {
+        vector<Edge> row;
+        if (index) {
+            for (int i = selected_bounds[c]; i < selected_bounds[c + 1]; ++i) {
+                int node_id = selected[i];
+                const char* q = begin + index->starts[node_id - 1];
+                const char* line_end = begin + index->starts[node_id];
+                chunk_bytes[c] += line_end - q;
+                parseLine(q, line_end, node_id, c, row);
+            }
             continue;
         }
-        
-        // Get partition for this node from the .part.8 file
-        int partition = node_to_partition[node_id-1]; // 0-based indexing for partition array
-        
-        // Get original node ID using mapping
-        int orig_node;
-        if (use_mapping) {
-            // For non-social graphs, use the mapping file
-            auto it = metis_to_original.find(node_id);
-            if (it != metis_to_original.end()) {
-                orig_node = it->first;
-            } else {
-                // If no mapping exists, use node_id as fallback
-                orig_node = node_id;
+        const char* q = bounds[c];
+        const char* chunk_end = bounds[c + 1];
+        int node_id = first_node[c];
+        chunk_bytes[c] = chunk_end - q;
+        while (q < chunk_end) {
+            const char* line_end = static_cast<const char*>(memchr(q, '\n', chunk_end - q));
+            if (!line_end) line_end = chunk_end;
+            node_id++; // 1-based node ID in the .graph file
+            parseLine(q, line_end, node_id, c, row);
+            q = line_end < chunk_end ? line_end + 1 : chunk_end;
+        }
+    }
+
+    max_id = max(total_nodes, num_lines);
+    for (int m : chunk_max) max_id = max(max_id, m);
+
+    // Concatenate the chunks of every group in node order
+    groups.assign(num_groups, ParsedRows());
+    for (int g = 0; g < num_groups; ++g) {
+        vector<size_t> row_base(chunks + 1, 0), edge_base(chunks + 1, 0);
+        for (int c = 0; c < chunks; ++c) {
+            row_base[c + 1] = row_base[c] + local[c][g].row_ids.size();
+            edge_base[c + 1] = edge_base[c] + local[c][g].row_edges.size();
+        }
+        ParsedRows& out = groups[g];
+        out.row_ids.resize(row_base[chunks]);
+        out.row_offsets.resize(row_base[chunks] + 1);
+        out.row_edges.resize(edge_base[chunks]);
+        #pragma omp parallel for schedule(static)
+        for (int c = 0; c < chunks; ++c) {
+            ParsedRows& in = local[c][g];
+            copy(in.row_ids.begin(), in.row_ids.end(), out.row_ids.begin() + row_base[c]);
+            copy(in.row_edges.begin(), in.row_edges.end(), out.row_edges.begin() + edge_base[c]);
+            for (size_t r = 1; r < in.row_offsets.size(); ++r) {
+                out.row_offsets[row_base[c] + r] = edge_base[c] + in.row_offsets[r];
             }
-        } else {
-            // For social graph, node_id is already the original ID
-            orig_node = node_id;
+            vector<int>().swap(in.row_ids);
+            vector<Edge>().swap(in.row_edges);
         }
+    }
 
-        // Parse neighbors for this node
-        istringstream iss(line);
-        string nbr_line = line;
-        
-        int neighbor, weight;
-        while (iss >> neighbor) {
-            if (use_mapping) {
-                // For mention/retweet/reply graphs, read the weight
-                iss >> weight;
-            } else {
-                // For social graph, weight is always 1
-                weight = 1;
+    uint64_t bytes = index ? 0 : file.size;
+    if (index) {
+        for (uint64_t b : chunk_bytes) bytes += b;
+    }
+    ingestStats().add(bytes, omp_get_wtime() - start);
+    return true;
+}
+
+// Reads a METIS .part file; entry i is the partition of METIS node i+1.
+vector<int> loadPartitions(const string& part_file, int num_parts) {
+    vector<int> node_to_partition;
+    if (!text_detail::parseIntFile(part_file, node_to_partition)) {
+        cerr << "Error: Cannot open partition file: " << part_file << endl;
+        return node_to_partition;
+    }
+
+    for (int& p : node_to_partition) {
+        if (p < 0 || p >= num_parts) {
+            cerr << "Warning: Invalid partition " << p << " (should be 0-" << (num_parts-1) << ")" << endl;
+            p = 0; // Default to partition 0 if invalid
+        }
+    }
+
+//    cout << "Loaded " << node_to_partition.size() << " partition assignments from " << part_file << endl;
+    return node_to_partition;
+}
+
+// Reads "<real_id> <metis_id>" lines into a dense METIS ID -> real ID table.
+// Entries without a mapping hold -1.
+vector<int> loadMapping(const string& mapping_file) {
+    vector<int> mapping, values;
+    if (!text_detail::parseIntFile(mapping_file, values)) {
+        cerr << "Error: Cannot open mapping file: " << mapping_file << endl;
+        return mapping;
+    }
+
+    int max_metis = -1;
+    for (size_t i = 1; i < values.size(); i += 2) max_metis = max(max_metis, values[i]);
+    mapping.assign(max_metis + 1, -1);
+    for (size_t i = 0; i + 1 < values.size(); i += 2) {
+        int real_id = values[i], metis_id = values[i + 1];
+        if (metis_id < 0) continue;
+        mapping[metis_id] = real_id;
+    }
+    return mapping;
+}
+
+// Translates a METIS node ID to its real-world ID, falling back to the METIS ID.
+inline int realNodeId(const vector<int>& mapping, int node) {
+    if (node >= 0 && node < static_cast<int>(mapping.size()) && mapping[node] >= 0) {
+        return mapping[node];
+    }
+    return node;
+}
+
+// Builds one CSRGraph per partition (subgraphs must be sized to the partition
+// count). With only_part >= 0, lines owned by other partitions are skipped
+// before parsing and only subgraphs[only_part] is filled; with a line index
+// they are not read at all. Returns false if there is no partition vector or
+// the graph file cannot be opened.
+bool loadGraph(const string& graph_file,
+               const vector<int>& node_to_partition,
+               vector<CSRGraph>& subgraphs,
+               bool use_mapping,
+               int only_part = -1,
+               const MetisLineIndex* index = nullptr) {
+    if (node_to_partition.empty()) return false;
+
+    // Rows are collected per partition in METIS order, then compacted to CSR.
+    // For mention/retweet/reply graphs entries carry a weight; for the social
+    // graph the weight is always 1.
+    int num_parts = static_cast<int>(subgraphs.size());
+    int known = static_cast<int>(node_to_partition.size());
+    auto group_of = [&](int node_id) {
+        // Skip if we don't have partition information for this node
+        if (node_id > known) return -1;
+        int partition = node_to_partition[node_id - 1]; // 0-based indexing for partition array
+        return only_part >= 0 && partition != only_part ? -1 : partition;
+    };
+
+    vector<ParsedRows> rows;
+    int total_nodes, max_id, num_lines;
+    if (!parseMetisRows(graph_file, use_mapping, num_parts, group_of, rows,
+                        total_nodes, max_id, num_lines, index)) {
+        cerr << "Error: Cannot open graph file: " << graph_file << endl;
+        return false;
+    }
+//    cout << "Graph has " << total_nodes << " nodes" << endl;
+    if (num_lines > known) {
+        cerr << "Warning: No partition info for nodes " << known + 1 << "-" << num_lines
+             << ", skipping" << endl;
+    }
+
+    // Add edges to the appropriate subgraph based on partition
+    vector<int> slot(max_id + 1, -1);
+    for (int p = 0; p < num_parts; ++p) {
+        if (only_part >= 0 && p != only_part) continue;
+        buildCSR(rows[p].row_ids, rows[p].row_offsets, rows[p].row_edges, slot, subgraphs[p]);
+        rows[p] = ParsedRows();
+    }
+    return true;
+}
+
+// Same, reading the partition vector from a METIS .part file.
+bool loadGraph(const string& graph_file,
+               const string& part_file,
+               vector<CSRGraph>& subgraphs,
+               bool use_mapping,
+               int only_part = -1) {
+    // Load partition file
+    vector<int> node_to_partition = loadPartitions(part_file, static_cast<int>(subgraphs.size()));
+    return loadGraph(graph_file, node_to_partition, subgraphs, use_mapping, only_part);
+}
+
+// Loads the union of the listed partitions as a single CSRGraph; lines owned
+// by other partitions are skipped before parsing. Returns false if the graph
+// file cannot be read.
+bool loadGraphParts(const string& graph_file,
+                    const vector<int>& node_to_partition,
+                    const vector<int>& parts,
+                    int num_parts,
+                    CSRGraph& graph,
+                    bool use_mapping,
+                    const MetisLineIndex* index = nullptr) {
+    vector<char> wanted(num_parts, 0);
+    for (int p : parts) wanted[p] = 1;
+    vector<int> selected(node_to_partition.size());
+    for (size_t i = 0; i < node_to_partition.size(); ++i) {
+        selected[i] = wanted[node_to_partition[i]] ? 0 : 1;
+    }
+    vector<CSRGraph> subgraphs(2);
+    if (!loadGraph(graph_file, selected, subgraphs, use_mapping, 0, index)) return false;
+    graph = move(subgraphs[0]);
+    return true;
+}
+
+// Combines several partitions of the same graph into one CSRGraph whose
+// ghosts are the neighbors none of them own.
+CSRGraph mergeSubgraphs(const vector<CSRGraph>& parts) {
+    vector<pair<int, pair<int, int>>> owned;   // METIS ID -> (part, local ID)
+    int max_id = 0;
+    for (size_t p = 0; p < parts.size(); ++p) {
+        for (int v = 0; v < parts[p].num_local; ++v) {
+            owned.push_back({parts[p].vertex_ids[v], {static_cast<int>(p), v}});
+        }
+        for (int id : parts[p].vertex_ids) max_id = max(max_id, id);
+    }
+    sort(owned.begin(), owned.end());
+
+    vector<int> row_ids;
+    vector<int64_t> row_offsets(1, 0);
+    vector<Edge> row_edges;
+    for (const auto& [id, where] : owned) {
+        const CSRGraph& g = parts[where.first];
+        int v = where.second;
+        for (int e = 0; e < g.degree(v); ++e) {
+            row_edges.push_back({g.vertex_ids[g.row(v)[e]], g.rowWeights(v)[e]});
+        }
+        row_ids.push_back(id);
+        row_offsets.push_back(static_cast<int64_t>(row_edges.size()));
+    }
+
+    CSRGraph merged;
+    vector<int> slot(max_id + 1, -1);
+    buildCSR(row_ids, row_offsets, row_edges, slot, merged);
+    return merged;
+}
+
+// Installs the halo of `graph` from a packed buffer holding, for each ghost in
+// local ID order, its full degree followed by its METIS neighbor IDs.
+void setHalo(CSRGraph& graph, const vector<int>& packed) {
+    int max_id = 0;
+    for (int id : graph.vertex_ids) max_id = max(max_id, id);
+    vector<int> slot(max_id + 1, -1);
+    for (int v = 0; v < graph.numVertices(); ++v) {
+        slot[graph.vertex_ids[v]] = v;
+    }
+
+    int num_ghosts = graph.numGhosts();
+    graph.halo_offsets.assign(num_ghosts + 1, 0);
+    graph.halo_degrees.assign(num_ghosts, 0);
+    graph.halo_neighbors.clear();
+
+    // Only neighbors this graph knows can meet a local row in an intersection
+    size_t pos = 0;
+    for (int g = 0; g < num_ghosts; ++g) {
+        int deg = packed[pos++];
+        graph.halo_degrees[g] = deg;
+        size_t row_start = graph.halo_neighbors.size();
+        for (int i = 0; i < deg; ++i) {
+            int id = packed[pos++];
+            if (id <= max_id && slot[id] >= 0) {
+                graph.halo_neighbors.push_back(slot[id]);
             }
-            
-            // Map neighbor ID if needed
-            int orig_nbr;
-            if (use_mapping) {
-                auto it = metis_to_original.find(neighbor);
-                if (it != metis_to_original.end()) {
-                    orig_nbr = it->first;
-                } else {
-                    orig_nbr = neighbor;
-                }
-            } else {
-                orig_nbr = neighbor;
+        }
+        sort(graph.halo_neighbors.begin() + row_start, graph.halo_neighbors.end());
+        graph.halo_offsets[g + 1] = static_cast<int64_t>(graph.halo_neighbors.size());
+    }
+}
+
+// Fills the halo of `graph` straight from the METIS text file by parsing only
+// the lines of its ghost vertices; with a line index the other lines are not
+// read at all. Returns false if the file cannot be read.
+bool loadTextHalo(const string& graph_file, CSRGraph& graph, bool use_mapping,
+                  const MetisLineIndex* index = nullptr) {
+    int max_id = 0;
+    for (int v = graph.num_local; v < graph.numVertices(); ++v) {
+        max_id = max(max_id, graph.vertex_ids[v]);
+    }
+    vector<int> ghost_of(max_id + 1, -1);
+    for (int v = graph.num_local; v < graph.numVertices(); ++v) {
+        ghost_of[graph.vertex_ids[v]] = v - graph.num_local;
+    }
+
+    vector<ParsedRows> parsed;
+    int total_nodes, file_max_id, num_lines;
+    auto group_of = [&](int node_id) { return node_id <= max_id && ghost_of[node_id] >= 0 ? 0 : -1; };
+    if (!parseMetisRows(graph_file, use_mapping, 1, group_of, parsed,
+                        total_nodes, file_max_id, num_lines, index)) {
+        cerr << "Error: Cannot open graph file: " << graph_file << endl;
+        return false;
+    }
+
+    // Ghosts without a row in the file keep an empty one
+    vector<vector<int>> rows(graph.numGhosts());
+    const ParsedRows& found = parsed[0];
+    for (size_t r = 0; r < found.row_ids.size(); ++r) {
+        vector<int>& row = rows[ghost_of[found.row_ids[r]]];
+        for (int64_t e = found.row_offsets[r]; e < found.row_offsets[r + 1]; ++e) {
+            row.push_back(found.row_edges[e].neighbor);
+        }
+    }
+
+    vector<int> packed;
+    for (const auto& row : rows) {
+        packed.push_back(static_cast<int>(row.size()));
+        packed.insert(packed.end(), row.begin(), row.end());
+    }
+    setHalo(graph, packed);
+    return true;
+}
+
+// Fills the halo of every partition from its in-memory siblings, for drivers
+// that hold all partitions in one process.
+void attachHalos(vector<CSRGraph>& subgraphs) {
+    int max_id = 0;
+    for (const auto& g : subgraphs) {
+        for (int v = 0; v < g.num_local; ++v) max_id = max(max_id, g.vertex_ids[v]);
+    }
+    vector<int> owner_part(max_id + 1, -1), owner_local(max_id + 1, -1);
+    for (size_t p = 0; p < subgraphs.size(); ++p) {
+        for (int v = 0; v < subgraphs[p].num_local; ++v) {
+            owner_part[subgraphs[p].vertex_ids[v]] = static_cast<int>(p);
+            owner_local[subgraphs[p].vertex_ids[v]] = v;
+        }
+    }
+
+    vector<int> packed;
+    for (auto& g : subgraphs) {
+        packed.clear();
+        for (int v = g.num_local; v < g.numVertices(); ++v) {
+            int id = g.vertex_ids[v];
+            if (id > max_id || owner_part[id] < 0) {
+                packed.push_back(0);
+                continue;
+            }
+            const CSRGraph& owner = subgraphs[owner_part[id]];
+            int l = owner_local[id];
+            packed.push_back(owner.degree(l));
+            for (int e = 0; e < owner.degree(l); ++e) {
+                packed.push_back(owner.vertex_ids[owner.row(l)[e]]);
             }
-            
-            // Add edge to the appropriate subgraph based on partition
-            subgraphs[partition][orig_node].push_back({orig_nbr, weight});
         }
+        setHalo(g, packed);
     }
 }
 
@@ -181,12 +806,12 @@ void loadGraph(const string& graph_file,
 //             continue;
 //         }
 
-//         vector<unordered_map<int, vector<Edge>>> subgraphs(NUM_PARTS);
-//         loadGraph(graph_path, part_path, map_path, subgraphs, use_mapping);
+//         vector<CSRGraph> subgraphs(NUM_PARTS);
+//         loadGraph(graph_path, part_path, subgraphs, use_mapping);
 
 //         cout << "\n====== Loaded graph type: " << gtype << " ======\n";
 //         for (int i = 0; i < NUM_PARTS; ++i) {
-//             cout << "Subgraph " << i << " has " << subgraphs[i].size() << " nodes." << endl;
+//             cout << "Subgraph " << i << " has " << subgraphs[i].num_local << " nodes." << endl;
 //         }
 
 //         // if (gtype == "mention") {
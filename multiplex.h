@@ -0,0 +1,141 @@
+#ifndef MULTIPLEX_H
+#define MULTIPLEX_H
+
+#include <vector>
+#include <algorithm>
+
+#include "load_graph.h"
+#include "Influence.h"
+
+using namespace std;
+
+// The four Higgs layers on one dense vertex index. Shared index i stands for
+// real-world user real_ids[i] in every layer; layers[l] is a CSRGraph over
+// that index (num_local == real_ids.size(), no ghosts), with an empty row
+// where the user is not active in layer l. Rows are sorted by shared index,
+// so the scoring kernels of Influence.h run on a layer unchanged.
+struct MultiplexGraph {
+    vector<int> real_ids;       // shared index -> real-world ID, ascending
+    vector<CSRGraph> layers;    // graph_types order
+
+    int numVertices() const { return static_cast<int>(real_ids.size()); }
+};
+
+// Per-layer scores and their weighted combination, all over the shared index.
+struct MultiplexScores {
+    vector<vector<double>> layers;
+    vector<double> combined;
+};
+
+// Builds the multiplex from whole-graph layers (one CSRGraph per layer in
+// graph_types order, vertex_ids holding METIS IDs) and each layer's METIS ->
+// real ID mapping; an empty mapping means METIS IDs are real IDs. A layer
+// with no vertices is kept as an empty graph.
+MultiplexGraph buildMultiplex(const vector<CSRGraph>& layer_graphs,
+                              const vector<vector<int>>& mappings) {
+    MultiplexGraph mx;
+    size_t num_layers = layer_graphs.size();
+
+    // Real IDs of every vertex of every layer, including neighbors without a row
+    vector<vector<int>> real_of(num_layers);
+    for (size_t l = 0; l < num_layers; ++l) {
+        const CSRGraph& g = layer_graphs[l];
+        real_of[l].resize(g.numVertices());
+        for (int v = 0; v < g.numVertices(); ++v) {
+            real_of[l][v] = realNodeId(mappings[l], g.vertex_ids[v]);
+        }
+        mx.real_ids.insert(mx.real_ids.end(), real_of[l].begin(), real_of[l].end());
+    }
+    sort(mx.real_ids.begin(), mx.real_ids.end());
+    mx.real_ids.erase(unique(mx.real_ids.begin(), mx.real_ids.end()), mx.real_ids.end());
+
+    int n = mx.numVertices();
+    int max_real = mx.real_ids.empty() ? 0 : mx.real_ids.back();
+    vector<int> index(max_real + 1, -1);
+    for (int i = 0; i < n; ++i) {
+        index[mx.real_ids[i]] = i;
+    }
+
+    mx.layers.resize(num_layers);
+    for (size_t l = 0; l < num_layers; ++l) {
+        const CSRGraph& g = layer_graphs[l];
+        CSRGraph& out = mx.layers[l];
+        vector<int>& shared = real_of[l];
+        for (int v = 0; v < g.numVertices(); ++v) {
+            shared[v] = index[shared[v]];
+        }
+
+        out.num_local = n;
+        out.vertex_ids = mx.real_ids;
+        out.offsets.assign(n + 1, 0);
+        for (int v = 0; v < g.num_local; ++v) {
+            out.offsets[shared[v] + 1] = g.degree(v);
+        }
+        for (int i = 0; i < n; ++i) {
+            out.offsets[i + 1] += out.offsets[i];
+        }
+        out.neighbors.resize(g.numEdges());
+        out.weights.resize(g.numEdges());
+
+        // Relabel each row onto the shared index and restore its order
+        #pragma omp parallel
+        {
+            vector<pair<int, int>> row;
+            #pragma omp for schedule(dynamic, 256)
+            for (int v = 0; v < g.num_local; ++v) {
+                row.clear();
+                for (int e = 0; e < g.degree(v); ++e) {
+                    row.emplace_back(shared[g.row(v)[e]], g.rowWeights(v)[e]);
+                }
+                sort(row.begin(), row.end());
+                int64_t base = out.offsets[shared[v]];
+                for (size_t i = 0; i < row.size(); ++i) {
+                    out.neighbors[base + i] = row[i].first;
+                    out.weights[base + i] = row[i].second;
+                }
+            }
+        }
+    }
+    return mx;
+}
+
+// Scores every layer and combines them with `weights` (one per layer). With
+// the per-vertex engine all layers are scored in one parallel sweep over the
+// shared index, so a user active in several layers has all of their rows
+// handled by the same thread back to back. The other engines are run layer
+// by layer and combined afterwards.
+MultiplexScores computeMultiplexScores(const MultiplexGraph& mx,
+                                       const vector<double>& weights,
+                                       const ScoreOptions& options = ScoreOptions()) {
+    int n = mx.numVertices();
+    size_t num_layers = mx.layers.size();
+    MultiplexScores result;
+    result.combined.assign(n, 0.0);
+
+    if (options.engine != ScoreEngine::Vertex) {
+        for (size_t l = 0; l < num_layers; ++l) {
+            result.layers.push_back(computeInfluenceScores(mx.layers[l], options));
+        }
+    } else {
+        result.layers.assign(num_layers, vector<double>(n, 0.0));
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int v = 0; v < n; v++) {
+            for (size_t l = 0; l < num_layers; ++l) {
+                const CSRGraph& g = mx.layers[l];
+                result.layers[l][v] = scoreEdges(g, v, g.offsets[v], g.offsets[v + 1]);
+            }
+        }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; v++) {
+        double overall = 0.0;
+        for (size_t l = 0; l < num_layers; ++l) {
+            overall += weights[l] * result.layers[l][v];
+        }
+        result.combined[v] = overall;
+    }
+    return result;
+}
+
+#endif
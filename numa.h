@@ -0,0 +1,283 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "load_graph.h"
+#include "profile.h"
+
+using namespace std;
+
+// NUMA placement for the shared-memory scoring path. Partitions are built by
+// whichever thread loaded them, so on a multi-socket host all their pages sit
+// on one node and threads on the other sockets read every row remotely.
+//   Off:        leave the arrays where the loader put them
+//   FirstTouch: pin threads to nodes and copy each partition so the rows of a
+//               static block of vertices are first written, and so placed,
+//               by the thread whose node scores them
+//   Replicate:  as FirstTouch, plus one copy of the adjacency per node that
+//               the node's threads read instead of the shared one
+// Nodes and their CPUs come from /sys/devices/system/node; no libnuma needed.
+enum class NumaMode { Off, FirstTouch, Replicate };
+
+NumaMode parseNumaMode(const string& name) {
+    if (name == "first-touch") return NumaMode::FirstTouch;
+    if (name == "replicate") return NumaMode::Replicate;
+    if (name != "off") cerr << "Warning: Unknown NUMA mode '" << name << "', using off" << endl;
+    return NumaMode::Off;
+}
+
+inline const char* numaModeName(NumaMode mode) {
+    return mode == NumaMode::FirstTouch ? "first-touch" : mode == NumaMode::Replicate ? "replicate" : "off";
+}
+
+// CPUs of every NUMA node this process may run on.
+struct NumaTopology {
+    vector<vector<int>> node_cpus;
+
+    int nodes() const { return static_cast<int>(node_cpus.size()); }
+};
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+vector<int> parseCpuList(const string& list) {
+    vector<int> cpus;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        size_t dash = item.find('-');
+        int first = atoi(item.c_str());
+        int last = dash == string::npos ? first : atoi(item.c_str() + dash + 1);
+        for (int c = first; c <= last; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// Nodes with at least one CPU in this process's affinity mask. Falls back to
+// a single node holding every allowed CPU when sysfs has no node entries.
+NumaTopology detectNumaTopology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    NumaTopology topology;
+    for (int node = 0;; ++node) {
+        ifstream in("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if (!in) break;
+        string list;
+        getline(in, list);
+        vector<int> cpus;
+        for (int c : parseCpuList(list)) {
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        }
+        if (!cpus.empty()) topology.node_cpus.push_back(cpus);
+    }
+    if (topology.node_cpus.empty()) {
+        vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        }
+        if (cpus.empty()) cpus.push_back(0);
+        topology.node_cpus.push_back(cpus);
+    }
+    return topology;
+}
+
+// Node of OpenMP thread t when `threads` threads are spread over `nodes`:
+// contiguous blocks, so the contiguous vertex blocks of a static schedule
+// (and the pages they first touch) stay on one node.
+inline int threadNode(int t, int threads, int nodes) {
+    return static_cast<int>(static_cast<int64_t>(t) * nodes / max(1, threads));
+}
+
+// Pins every thread of the default team to one CPU of its node, round-robin
+// within the node. Returns the node of each thread. The team keeps its
+// threads between parallel regions, so the pinning holds for later regions
+// of the same size.
+vector<int> pinThreads(const NumaTopology& topology) {
+    int threads = omp_get_max_threads();
+    vector<int> thread_node(threads);
+    for (int t = 0; t < threads; ++t) thread_node[t] = threadNode(t, threads, topology.nodes());
+    vector<int> failed(threads, 0);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num();
+        int node = thread_node[t];
+        int first = t;
+        while (first > 0 && thread_node[first - 1] == node) first--;
+        const vector<int>& cpus = topology.node_cpus[node];
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[(t - first) % cpus.size()], &set);
+        failed[t] = sched_setaffinity(0, sizeof(set), &set) != 0;
+    }
+    if (count(failed.begin(), failed.end(), 1) > 0) {
+        cerr << "Warning: Could not pin every thread to its NUMA node" << endl;
+    }
+    return thread_node;
+}
+
+// Hands the whole pages inside `v` back to the kernel. They read as zero,
+// like the value-initialized vector, and the next write to each one
+// allocates it on the node of the writing thread.
+template <typename T>
+void releasePages(vector<T>& v) {
+    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(v.data()) + page - 1) & ~(page - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(v.data() + v.size()) & ~(page - 1);
+    if (end > begin) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+}
+
+// Sized for `graph` with no pages touched yet, for the copies below.
+CSRGraph unplacedCopy(const CSRGraph& graph) {
+    CSRGraph out;
+    out.num_local = graph.num_local;
+    out.vertex_ids = graph.vertex_ids;
+    out.offsets.resize(graph.offsets.size());
+    out.neighbors.resize(graph.neighbors.size());
+    out.weights.resize(graph.weights.size());
+    out.halo_offsets.resize(graph.halo_offsets.size());
+    out.halo_neighbors.resize(graph.halo_neighbors.size());
+    out.halo_degrees = graph.halo_degrees;
+    releasePages(out.offsets);
+    releasePages(out.neighbors);
+    releasePages(out.weights);
+    releasePages(out.halo_offsets);
+    releasePages(out.halo_neighbors);
+    return out;
+}
+
+// Copies `graph` so each thread writes the rows it scores under the static
+// schedule first, then frees the original arrays. Dynamic schedules do not
+// follow it, but the pages still end up spread over every node instead of
+// one, so serialVersion selects the static schedule with it by default.
+// Scores are unchanged.
+void placeGraph(CSRGraph& graph) {
+    CSRGraph out = unplacedCopy(graph);
+    int n = graph.num_local;
+    if (!out.offsets.empty()) out.offsets[0] = 0;
+
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static) nowait
+        for (int v = 0; v < n; ++v) {
+            int64_t begin = graph.offsets[v], end = graph.offsets[v + 1];
+            out.offsets[v + 1] = end;
+            copy(graph.neighbors.begin() + begin, graph.neighbors.begin() + end, out.neighbors.begin() + begin);
+            copy(graph.weights.begin() + begin, graph.weights.begin() + end, out.weights.begin() + begin);
+        }
+
+        // Ghost rows are read from every block, so they are simply spread out
+        int ghosts = graph.hasHalo() ? graph.numGhosts() : 0;
+        #pragma omp for schedule(static)
+        for (int g = 0; g < ghosts; ++g) {
+            int64_t begin = graph.halo_offsets[g], end = graph.halo_offsets[g + 1];
+            out.halo_offsets[g + 1] = end;
+            copy(graph.halo_neighbors.begin() + begin, graph.halo_neighbors.begin() + end,
+                 out.halo_neighbors.begin() + begin);
+        }
+    }
+    if (!out.halo_offsets.empty()) out.halo_offsets[0] = 0;
+    graph = move(out);
+}
+
+// One read-only copy of a partition per node, written by that node's own
+// threads, and the node of every thread. The vertex kernel reads the copy of
+// the node it runs on (see ScoreOptions::replicas).
+struct NumaReplicas {
+    vector<CSRGraph> graphs;
+    vector<int> thread_node;
+
+    const CSRGraph& forThread() const {
+        return graphs[thread_node[omp_get_thread_num() % thread_node.size()]];
+    }
+};
+
+// Share [index * size / parts, (index + 1) * size / parts) of `size` elements.
+inline void sliceOf(size_t size, int index, int parts, size_t& begin, size_t& end) {
+    begin = size * index / parts;
+    end = size * (index + 1) / parts;
+}
+
+template <typename T>
+inline void copySlice(const vector<T>& src, vector<T>& dst, int index, int parts) {
+    size_t begin, end;
+    sliceOf(src.size(), index, parts, begin, end);
+    copy(src.begin() + begin, src.begin() + end, dst.begin() + begin);
+}
+
+// Builds the replicas of `graph`. Nodes without threads get no copy.
+NumaReplicas replicateGraph(const CSRGraph& graph, const vector<int>& thread_node, int nodes) {
+    NumaReplicas replicas;
+    replicas.thread_node = thread_node;
+    replicas.graphs.resize(nodes);
+    vector<int> node_threads(nodes, 0);
+    for (int node : thread_node) node_threads[node]++;
+    for (int node = 0; node < nodes; ++node) {
+        if (node_threads[node] > 0) replicas.graphs[node] = unplacedCopy(graph);
+    }
+
+    // Threads of a node split the copy of that node's replica evenly
+    #pragma omp parallel num_threads(static_cast<int>(thread_node.size()))
+    {
+        int t = omp_get_thread_num();
+        int node = thread_node[t];
+        int index = 0;
+        for (int u = 0; u < t; ++u) index += thread_node[u] == node;
+        int parts = node_threads[node];
+        CSRGraph& out = replicas.graphs[node];
+        copySlice(graph.offsets, out.offsets, index, parts);
+        copySlice(graph.neighbors, out.neighbors, index, parts);
+        copySlice(graph.weights, out.weights, index, parts);
+        copySlice(graph.halo_offsets, out.halo_offsets, index, parts);
+        copySlice(graph.halo_neighbors, out.halo_neighbors, index, parts);
+    }
+    return replicas;
+}
+
+// Elements compared by each thread's intersections so far (profile counters).
+vector<long long> threadComparisons() {
+    vector<long long> comparisons;
+    for (const ProfileSlot& s : profile().slots) {
+        comparisons.push_back(s.counters[static_cast<int>(Counter::Comparisons)]);
+    }
+    return comparisons;
+}
+
+// Per-node scoring report: threads, the busiest thread's time and the
+// adjacency the node's intersections read. Bytes are an upper bound from the
+// comparison counter (4 bytes per element), so they need the profile build.
+void printNumaReport(const string& gtype, NumaMode mode, double place_seconds,
+                     const vector<int>& thread_node, int nodes,
+                     const vector<double>& busy_seconds, const vector<long long>& comparisons) {
+    cout << "\nNUMA nodes for Graph: " << gtype << " (" << numaModeName(mode) << ", placed in "
+         << place_seconds << " s)" << endl;
+    for (int node = 0; node < nodes; ++node) {
+        int threads = 0;
+        double busy = 0.0;
+        long long elements = 0;
+        for (size_t t = 0; t < thread_node.size(); ++t) {
+            if (thread_node[t] != node) continue;
+            threads++;
+            if (t < busy_seconds.size()) busy = max(busy, busy_seconds[t]);
+            if (t < comparisons.size()) elements += comparisons[t];
+        }
+        cout << "NUMA node " << node << " -> threads: " << threads << ", busy: " << busy << " s";
+        if (PROFILE_ENABLED) {
+            double gb = elements * sizeof(int) / 1e9;
+            cout << ", read: " << gb << " GB (" << (busy > 0 ? gb / busy : 0.0) << " GB/s)";
+        }
+        cout << endl;
+    }
+}
+
+#endif
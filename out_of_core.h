@@ -0,0 +1,440 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <future>
+#include <algorithm>
+#include <cstring>
+
+#include "load_graph.h"
+#include "binary_graph.h"
+#include "Influence.h"
+#include "profile.h"
+
+using namespace std;
+
+// Out-of-core scoring for layers whose adjacency does not fit in memory. The
+// METIS rows are split once into blocks of consecutive node IDs stored on
+// local disk, each at most a third of the memory budget so that three fit
+// in it. Scoring keeps one block of rows resident and streams in, in
+// ascending order, every block its edges point into. The edges between the
+// two blocks are scored while the next block is read by a loader thread.
+// Each row sums its edges in ascending neighbor order as it does in memory,
+// so the scores match the in-memory run to rounding. Edges to nodes without a
+// row count with degree 0, like ghosts without a halo row.
+//
+// Store layout, DIR/index then DIR/block.<b>, native byte order:
+//
+//   index:   BlockStoreHeader
+//            BlockEntry[num_blocks]
+//            int64 touched_offsets[num_blocks + 1]
+//            int32 touched[...]          blocks each block's edges reach
+//   block.b: BlockEntry (the same as in the index)
+//            int64 offsets[num_ids + 1]
+//            int32 neighbors[num_edges]  METIS IDs, sorted per row
+//            int32 weights[num_edges]
+//
+// The index is written last and records the source file's size and mtime and
+// the block size, so a partial, stale or differently sized store is rebuilt.
+
+const char BLOCK_STORE_MAGIC[8] = {'H', 'G', 'B', 'L', 'O', 'C', 'K', 'S'};
+const uint32_t BLOCK_STORE_VERSION = 1;
+
+// Bytes a block holds per node beyond its rows: a row pointer, and the
+// score and edge cursor kept for the resident block
+const int64_t BLOCK_NODE_BYTES = sizeof(int64_t) + sizeof(double) + sizeof(int64_t);
+
+struct BlockStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t weighted;
+    SourceStamp source;
+    uint64_t block_bytes;
+    int64_t num_blocks;
+    int64_t last_id;            // highest node ID with a line in the file
+};
+
+struct BlockEntry {
+    int64_t first_id;
+    int64_t num_ids;
+    int64_t num_edges;
+};
+
+inline int64_t blockBytes(int64_t num_ids, int64_t num_edges) {
+    return num_ids * BLOCK_NODE_BYTES + sizeof(int64_t) + num_edges * 2 * sizeof(int);
+}
+
+// Rows of nodes [first_id, first_id + num_ids), every node with a (possibly
+// empty) row.
+struct VertexBlock {
+    int first_id = 1;
+    int num_ids = 0;
+    vector<int64_t> offsets = {0};
+    vector<int> neighbors;
+    vector<int> weights;
+
+    int degree(int id) const { return static_cast<int>(offsets[id - first_id + 1] - offsets[id - first_id]); }
+    const int* row(int id) const { return neighbors.data() + offsets[id - first_id]; }
+    int64_t bytes() const { return blockBytes(num_ids, static_cast<int64_t>(neighbors.size())); }
+};
+
+struct BlockStore {
+    string dir;
+    BlockStoreHeader header = {};
+    vector<BlockEntry> blocks;
+    vector<int64_t> touched_offsets;
+    vector<int> touched;
+};
+
+// Counters of one out-of-core layer, for the report.
+struct OutOfCoreStats {
+    bool built = false;         // the store was (re)built by this run
+    double build_seconds = 0.0;
+    long long pairs = 0;        // block pairs scored
+    long long bytes_read = 0;
+    double read_seconds = 0.0;  // time the loader spent reading
+    double wait_seconds = 0.0;  // time the kernel waited for a block
+    double score_seconds = 0.0;
+    int64_t peak_bytes = 0;     // largest resident set of blocks
+};
+
+inline string blockPath(const string& dir, int64_t b) {
+    return dir + "/block." + to_string(b);
+}
+
+bool writeVertexBlock(const string& path, const VertexBlock& block, BlockEntry& entry) {
+    entry = {block.first_id, block.num_ids, static_cast<int64_t>(block.neighbors.size())};
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    out.write(reinterpret_cast<const char*>(block.offsets.data()), block.offsets.size() * sizeof(int64_t));
+    out.write(reinterpret_cast<const char*>(block.neighbors.data()), block.neighbors.size() * sizeof(int));
+    out.write(reinterpret_cast<const char*>(block.weights.data()), block.weights.size() * sizeof(int));
+    if (!out) {
+        cerr << "Error: Cannot write block " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+bool readVertexBlock(const string& path, const BlockEntry& expected, VertexBlock& block) {
+    ifstream in(path, ios::binary);
+    BlockEntry entry = {};
+    in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+    if (!in || memcmp(&entry, &expected, sizeof(entry)) != 0) {
+        cerr << "Error: Invalid block " << path << endl;
+        return false;
+    }
+    block.first_id = static_cast<int>(entry.first_id);
+    block.num_ids = static_cast<int>(entry.num_ids);
+    block.offsets.resize(entry.num_ids + 1);
+    block.neighbors.resize(entry.num_edges);
+    block.weights.resize(entry.num_edges);
+    in.read(reinterpret_cast<char*>(block.offsets.data()), block.offsets.size() * sizeof(int64_t));
+    in.read(reinterpret_cast<char*>(block.neighbors.data()), block.neighbors.size() * sizeof(int));
+    in.read(reinterpret_cast<char*>(block.weights.data()), block.weights.size() * sizeof(int));
+    if (!in) {
+        cerr << "Error: Truncated block " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Block holding node `id`, or -1 past the last block.
+inline int blockOf(const vector<BlockEntry>& blocks, int64_t id) {
+    auto it = upper_bound(blocks.begin(), blocks.end(), id, [](int64_t v, const BlockEntry& b) {
+        return v < b.first_id;
+    });
+    if (it == blocks.begin()) return -1;
+    --it;
+    return id < it->first_id + it->num_ids ? static_cast<int>(it - blocks.begin()) : -1;
+}
+
+// Opens the store in `dir` if it was built from the current `graph_file` with
+// the same block size.
+bool openBlockStore(const string& dir, const string& graph_file, bool weighted,
+                    uint64_t block_bytes, BlockStore& store) {
+    ifstream in(dir + "/index", ios::binary);
+    if (!in) return false;
+    BlockStoreHeader header = {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    SourceStamp source = sourceStamp(graph_file);
+    if (!in || memcmp(header.magic, BLOCK_STORE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BLOCK_STORE_VERSION || header.weighted != (weighted ? 1u : 0u) ||
+        header.source.size != source.size || header.source.mtime != source.mtime ||
+        header.block_bytes != block_bytes || header.num_blocks < 0) {
+        return false;
+    }
+    store.dir = dir;
+    store.header = header;
+    store.blocks.resize(header.num_blocks);
+    store.touched_offsets.resize(header.num_blocks + 1);
+    in.read(reinterpret_cast<char*>(store.blocks.data()), store.blocks.size() * sizeof(BlockEntry));
+    in.read(reinterpret_cast<char*>(store.touched_offsets.data()), store.touched_offsets.size() * sizeof(int64_t));
+    if (!in || store.touched_offsets.back() < 0) return false;
+    store.touched.resize(store.touched_offsets.back());
+    in.read(reinterpret_cast<char*>(store.touched.data()), store.touched.size() * sizeof(int));
+    return static_cast<bool>(in);
+}
+
+// Splits `graph_file` into blocks of at most `block_bytes` (a single larger
+// row gets a block of its own) with one streaming pass over the text, then
+// reads the blocks back once to list the blocks each one's edges reach.
+// Only one block is held at a time.
+bool buildBlockStore(const string& graph_file, bool weighted, uint64_t block_bytes,
+                     const string& dir, BlockStore& store) {
+    using namespace text_detail;
+    double start = omp_get_wtime();
+    ifstream in(graph_file);
+    if (!in) {
+        cerr << "Error: Cannot open graph file: " << graph_file << endl;
+        return false;
+    }
+    // Drop the index first so an interrupted build is never taken as valid
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    filesystem::remove(dir + "/index", ec);
+
+    store = BlockStore();
+    store.dir = dir;
+    VertexBlock block;
+    auto flush = [&]() {
+        BlockEntry entry;
+        if (!writeVertexBlock(blockPath(dir, store.blocks.size()), block, entry)) return false;
+        store.blocks.push_back(entry);
+        block = VertexBlock();
+        return true;
+    };
+
+    // First line is the metadata; line i after it is the row of node i
+    string line;
+    getline(in, line);
+    uint64_t text_bytes = line.size() + 1;
+    int node_id = 0;
+    long long oversized = 0;
+    vector<Edge> row;
+    while (getline(in, line)) {
+        text_bytes += line.size() + 1;
+        node_id++;
+        row.clear();
+        const char* p = line.data();
+        const char* end = p + line.size();
+        int neighbor, weight;
+        while (nextInt(p, end, neighbor)) {
+            weight = 1;
+            if (weighted && !nextInt(p, end, weight)) weight = 1;
+            row.push_back({neighbor, weight});
+        }
+        canonicalizeRow(row);
+
+        if (blockBytes(1, static_cast<int64_t>(row.size())) > static_cast<int64_t>(block_bytes)) oversized++;
+        int64_t edges = static_cast<int64_t>(block.neighbors.size());
+        if (block.num_ids > 0 &&
+            blockBytes(block.num_ids + 1, edges + static_cast<int64_t>(row.size())) > static_cast<int64_t>(block_bytes)) {
+            if (!flush()) return false;
+        }
+        if (block.num_ids == 0) block.first_id = node_id;
+        for (const Edge& e : row) {
+            block.neighbors.push_back(e.neighbor);
+            block.weights.push_back(e.weight);
+        }
+        block.offsets.push_back(static_cast<int64_t>(block.neighbors.size()));
+        block.num_ids++;
+    }
+    if (block.num_ids > 0 && !flush()) return false;
+    ingestStats().add(text_bytes, omp_get_wtime() - start);
+    if (oversized > 0) {
+        cerr << "Warning: " << oversized << " rows exceed the block size of " << block_bytes
+             << " bytes; each gets a block of its own" << endl;
+    }
+    for (size_t b = store.blocks.size(); filesystem::remove(blockPath(dir, b), ec); ++b) {}
+
+    // Blocks reached by each block's edges, ascending
+    store.touched_offsets.assign(1, 0);
+    vector<char> reached;
+    for (size_t b = 0; b < store.blocks.size(); ++b) {
+        if (!readVertexBlock(blockPath(dir, b), store.blocks[b], block)) return false;
+        reached.assign(store.blocks.size(), 0);
+        for (int nbr : block.neighbors) {
+            int target = blockOf(store.blocks, nbr);
+            if (target >= 0) reached[target] = 1;
+        }
+        for (size_t t = 0; t < reached.size(); ++t) {
+            if (reached[t]) store.touched.push_back(static_cast<int>(t));
+        }
+        store.touched_offsets.push_back(static_cast<int64_t>(store.touched.size()));
+    }
+
+    BlockStoreHeader& header = store.header;
+    memcpy(header.magic, BLOCK_STORE_MAGIC, sizeof(header.magic));
+    header.version = BLOCK_STORE_VERSION;
+    header.weighted = weighted ? 1 : 0;
+    header.source = sourceStamp(graph_file);
+    header.block_bytes = block_bytes;
+    header.num_blocks = static_cast<int64_t>(store.blocks.size());
+    header.last_id = node_id;
+
+    ofstream out(dir + "/index", ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(store.blocks.data()), store.blocks.size() * sizeof(BlockEntry));
+    out.write(reinterpret_cast<const char*>(store.touched_offsets.data()),
+              store.touched_offsets.size() * sizeof(int64_t));
+    out.write(reinterpret_cast<const char*>(store.touched.data()), store.touched.size() * sizeof(int));
+    if (!out) {
+        cerr << "Error: Cannot write block index in " << dir << endl;
+        return false;
+    }
+    return true;
+}
+
+// Block size for a memory budget: the resident block, the streamed one and
+// the one being read ahead.
+inline uint64_t blockBytesForBudget(uint64_t budget_bytes) {
+    return max<uint64_t>(budget_bytes / 3, 1);
+}
+
+// Opens the store for `graph_file` in `dir`, building it first if needed.
+bool prepareBlockStore(const string& graph_file, bool weighted, uint64_t budget_bytes,
+                       const string& dir, BlockStore& store, OutOfCoreStats& stats) {
+    uint64_t block_bytes = blockBytesForBudget(budget_bytes);
+    if (openBlockStore(dir, graph_file, weighted, block_bytes, store)) return true;
+    PhaseTimer timer(Phase::GraphParse);
+    double start = omp_get_wtime();
+    bool ok = buildBlockStore(graph_file, weighted, block_bytes, dir, store);
+    stats.built = true;
+    stats.build_seconds = omp_get_wtime() - start;
+    return ok;
+}
+
+namespace out_of_core_detail {
+
+struct LoadedBlock {
+    VertexBlock block;
+    bool ok = false;
+    double seconds = 0.0;
+};
+
+inline LoadedBlock loadBlock(const BlockStore* store, int b) {
+    LoadedBlock loaded;
+    double start = omp_get_wtime();
+    loaded.ok = readVertexBlock(blockPath(store->dir, b), store->blocks[b], loaded.block);
+    loaded.seconds = omp_get_wtime() - start;
+    return loaded;
+}
+
+// Scores the edges of every row of `home` that point into `other` (or, with
+// other == nullptr, past the last block), continuing from each row's cursor.
+void scoreBlockPair(const VertexBlock& home, const VertexBlock* other,
+                    vector<double>& scores, vector<int64_t>& cursor) {
+    int64_t limit = other ? static_cast<int64_t>(other->first_id) + other->num_ids : INT64_MAX;
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int r = 0; r < home.num_ids; ++r) {
+        int64_t e = cursor[r], end = home.offsets[r + 1];
+        const int* node_row = home.neighbors.data() + home.offsets[r];
+        int node_degree = static_cast<int>(end - home.offsets[r]);
+        double score = scores[r];
+        long long comparisons = 0, count = 0;
+        for (; e < end && home.neighbors[e] < limit; ++e) {
+            int nbr = home.neighbors[e];
+            int intersection = 0, nbr_degree = 0;
+            if (other && nbr >= other->first_id) {
+                nbr_degree = other->degree(nbr);
+                intersection = intersectionCount(node_row, node_degree, other->row(nbr), nbr_degree);
+                if (PROFILE_ENABLED) comparisons += intersectionWork(node_degree, nbr_degree);
+            }
+            score += home.weights[e] * edgeJaccard(intersection, node_degree, nbr_degree);
+            count++;
+        }
+        scores[r] = score;
+        cursor[r] = e;
+        profileCount(count, comparisons, 0);
+    }
+}
+
+}
+
+// Scores every node with a non-empty row and passes (METIS ID, score) to
+// emit, one block at a time in ID order. Block reads run one step ahead of
+// the kernel on a loader thread, in the order the pairs need them.
+template <class Emit>
+bool scoreOutOfCore(const BlockStore& store, Emit emit, OutOfCoreStats& stats) {
+    using namespace out_of_core_detail;
+    int num_blocks = static_cast<int>(store.blocks.size());
+
+    // Every block read, in the order the kernel needs it
+    vector<int> loads;
+    for (int b = 0; b < num_blocks; ++b) {
+        loads.push_back(b);
+        for (int64_t t = store.touched_offsets[b]; t < store.touched_offsets[b + 1]; ++t) {
+            if (store.touched[t] != b) loads.push_back(store.touched[t]);
+        }
+    }
+    auto entryBytes = [&](size_t i) {
+        if (i >= loads.size()) return int64_t(0);
+        const BlockEntry& entry = store.blocks[loads[i]];
+        return blockBytes(entry.num_ids, entry.num_edges);
+    };
+
+    size_t next = 0;
+    future<LoadedBlock> pending;
+    if (!loads.empty()) pending = async(launch::async, loadBlock, &store, loads[0]);
+    auto take = [&]() {
+        double start = omp_get_wtime();
+        LoadedBlock loaded = pending.get();
+        stats.wait_seconds += omp_get_wtime() - start;
+        stats.read_seconds += loaded.seconds;
+        stats.bytes_read += loaded.block.bytes();
+        if (++next < loads.size()) pending = async(launch::async, loadBlock, &store, loads[next]);
+        return loaded;
+    };
+
+    bool ok = true;
+    for (int b = 0; b < num_blocks && ok; ++b) {
+        LoadedBlock home = take();
+        if (!home.ok) {
+            ok = false;
+            break;
+        }
+        const VertexBlock& rows = home.block;
+        vector<double> scores(rows.num_ids, 0.0);
+        vector<int64_t> cursor(rows.offsets.begin(), rows.offsets.end() - 1);
+
+        double start = omp_get_wtime();
+        for (int64_t t = store.touched_offsets[b]; t < store.touched_offsets[b + 1]; ++t) {
+            int target = store.touched[t];
+            LoadedBlock other;
+            if (target != b) {
+                stats.score_seconds += omp_get_wtime() - start;
+                other = take();
+                start = omp_get_wtime();
+                if (!other.ok) {
+                    ok = false;
+                    break;
+                }
+            }
+            stats.peak_bytes = max(stats.peak_bytes, rows.bytes() + (target != b ? other.block.bytes() : 0) +
+                                                         entryBytes(next));
+            PhaseTimer timer(Phase::Scoring);
+            scoreBlockPair(rows, target != b ? &other.block : &rows, scores, cursor);
+            stats.pairs++;
+        }
+        if (!ok) break;
+
+        // Edges to nodes past the last line of the file
+        {
+            PhaseTimer timer(Phase::Scoring);
+            scoreBlockPair(rows, nullptr, scores, cursor);
+        }
+        stats.score_seconds += omp_get_wtime() - start;
+
+        for (int r = 0; r < rows.num_ids; ++r) {
+            if (rows.offsets[r + 1] > rows.offsets[r]) emit(rows.first_id + r, scores[r]);
+        }
+    }
+    if (pending.valid()) pending.wait();
+    return ok;
+}
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef PARTITIONER_H
+#define PARTITIONER_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+
+#include "load_graph.h"
+
+using namespace std;
+
+// In-process alternative to the gpmetis .part.N files. One streaming pass
+// over the vertices in METIS order puts each vertex in one of k parts, so any
+// part count is available at load time. Choices are LDG (neighbors already
+// in the part, scaled by its free capacity) or Fennel (neighbors minus the
+// marginal cost of growing the part). A part's load is the sum of
+// 1 + degree over its vertices, so a hub costs as much as the intersections
+// it brings. No part may exceed the mean load by more than STREAM_SLACK.
+enum class Partitioner { Metis, Ldg, Fennel };
+
+// Vertices scored against the same snapshot of assignments: 1/STREAM_ROUNDS
+// of the graph, within [16, STREAM_BATCH]. The batch size depends only on
+// the graph, so the result does not depend on the thread count.
+const int STREAM_BATCH = 4096;
+const int STREAM_ROUNDS = 512;
+const double STREAM_SLACK = 1.05;
+
+// Fennel's cost of a part with this load, with the usual exponent 1.5
+inline double fennelCost(double load) {
+    return load * sqrt(load);
+}
+
+Partitioner parsePartitioner(const string& name) {
+    if (name == "ldg") return Partitioner::Ldg;
+    if (name == "fennel") return Partitioner::Fennel;
+    if (name != "metis") cerr << "Warning: Unknown partitioner '" << name << "', using metis" << endl;
+    return Partitioner::Metis;
+}
+
+inline const char* partitionerName(Partitioner p) {
+    return p == Partitioner::Ldg ? "ldg" : p == Partitioner::Fennel ? "fennel" : "metis";
+}
+
+// Whole-graph adjacency over 0-based METIS IDs, without weights.
+struct StreamGraph {
+    vector<int64_t> offsets;
+    vector<int> neighbors;
+
+    int numNodes() const { return static_cast<int>(offsets.size()) - 1; }
+    int degree(int v) const { return static_cast<int>(offsets[v + 1] - offsets[v]); }
+};
+
+// Reads every row of a METIS graph file. Nodes without a line or without
+// edges get empty rows. The node count covers every ID seen, so a partition
+// vector of this size has an entry for each of them.
+bool loadStreamGraph(const string& graph_file, bool weighted, StreamGraph& g) {
+    vector<ParsedRows> rows;
+    int total_nodes, max_id, num_lines;
+    if (!parseMetisRows(graph_file, weighted, 1, [](int) { return 0; }, rows,
+                        total_nodes, max_id, num_lines)) {
+        cerr << "Error: Cannot open graph file: " << graph_file << endl;
+        return false;
+    }
+    const ParsedRows& all = rows[0];
+    g.offsets.assign(max_id + 1, 0);
+    for (size_t r = 0; r < all.row_ids.size(); ++r) {
+        g.offsets[all.row_ids[r]] = all.row_offsets[r + 1] - all.row_offsets[r];
+    }
+    for (int v = 0; v < max_id; ++v) g.offsets[v + 1] += g.offsets[v];
+    g.neighbors.resize(all.row_edges.size());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (size_t r = 0; r < all.row_ids.size(); ++r) {
+        int64_t out = g.offsets[all.row_ids[r] - 1];
+        for (int64_t e = all.row_offsets[r]; e < all.row_offsets[r + 1]; ++e) {
+            g.neighbors[out++] = all.row_edges[e].neighbor - 1;
+        }
+    }
+    return true;
+}
+
+// Entry v is the part of METIS node v+1, as read from a .part file.
+vector<int> streamPartition(const StreamGraph& g, int num_parts, Partitioner method) {
+    int n = g.numNodes();
+    vector<int> part(n, -1);
+    vector<double> load(num_parts, 0.0);
+    double total = static_cast<double>(n) + static_cast<double>(g.neighbors.size());
+    double capacity = STREAM_SLACK * total / num_parts;
+    double alpha = total > 0 ? (g.neighbors.size() / 2.0) * sqrt(num_parts) / fennelCost(total) : 0.0;
+
+    int batch = max(16, min(STREAM_BATCH, n / STREAM_ROUNDS));
+    vector<int> counts(static_cast<size_t>(batch) * num_parts);
+    for (int first = 0; first < n; first += batch) {
+        int last = min(n, first + batch);
+
+        // Neighbors of each vertex of the batch already placed in each part
+        fill(counts.begin(), counts.end(), 0);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int v = first; v < last; ++v) {
+            int* c = counts.data() + static_cast<size_t>(v - first) * num_parts;
+            for (int64_t e = g.offsets[v]; e < g.offsets[v + 1]; ++e) {
+                int p = part[g.neighbors[e]];
+                if (p >= 0) c[p]++;
+            }
+        }
+
+        // Placement in stream order against the current loads; a part that
+        // is full only takes a vertex when every part is
+        for (int v = first; v < last; ++v) {
+            const int* c = counts.data() + static_cast<size_t>(v - first) * num_parts;
+            double w = 1.0 + g.degree(v);
+            int best = 0;
+            double best_score = 0.0;
+            bool best_fits = false;
+            for (int p = 0; p < num_parts; ++p) {
+                bool fits = load[p] + w <= capacity || load[p] == 0.0;
+                double score = method == Partitioner::Ldg
+                    ? c[p] * (1.0 - load[p] / capacity)
+                    : c[p] - alpha * (fennelCost(load[p] + w) - fennelCost(load[p]));
+                bool better = p == 0 || (fits && !best_fits) ||
+                              (fits == best_fits && (score > best_score ||
+                                                     (score == best_score && load[p] < load[best])));
+                if (better) {
+                    best = p;
+                    best_score = score;
+                    best_fits = fits;
+                }
+            }
+            part[v] = best;
+            load[best] += w;
+        }
+    }
+    return part;
+}
+
+struct PartitionQuality {
+    int64_t edges = 0;
+    int64_t cut_edges = 0;
+    double vertex_imbalance = 1.0;  // largest part / mean, in vertices
+    double load_imbalance = 1.0;    // largest part / mean, in 1 + degree
+
+    double cutFraction() const { return edges > 0 ? static_cast<double>(cut_edges) / edges : 0.0; }
+};
+
+// Cut and balance of any partition vector of the graph. Nodes beyond the end
+// of a short vector (no partition info) are left out.
+PartitionQuality partitionQuality(const StreamGraph& g, const vector<int>& node_to_partition, int num_parts) {
+    PartitionQuality q;
+    int n = min(g.numNodes(), static_cast<int>(node_to_partition.size()));
+    int64_t entries = 0, cut = 0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:entries, cut)
+    for (int v = 0; v < n; ++v) {
+        for (int64_t e = g.offsets[v]; e < g.offsets[v + 1]; ++e) {
+            int u = g.neighbors[e];
+            if (u >= n) continue;
+            entries++;
+            if (node_to_partition[u] != node_to_partition[v]) cut++;
+        }
+    }
+    q.edges = entries / 2;
+    q.cut_edges = cut / 2;
+
+    vector<double> vertices(num_parts, 0.0), load(num_parts, 0.0);
+    for (int v = 0; v < n; ++v) {
+        vertices[node_to_partition[v]] += 1.0;
+        load[node_to_partition[v]] += 1.0 + g.degree(v);
+    }
+    double total_vertices = 0.0, total_load = 0.0;
+    for (int p = 0; p < num_parts; ++p) {
+        total_vertices += vertices[p];
+        total_load += load[p];
+    }
+    if (total_vertices > 0) {
+        q.vertex_imbalance = *max_element(vertices.begin(), vertices.end()) * num_parts / total_vertices;
+        q.load_imbalance = *max_element(load.begin(), load.end()) * num_parts / total_load;
+    }
+    return q;
+}
+
+void printPartitionQuality(const string& gtype, const string& name, const PartitionQuality& q,
+                           ostream& out = cout) {
+    out << "Partition for Graph: " << gtype << " -> " << name << ": cut " << 100.0 * q.cutFraction()
+        << "% of " << q.edges << " edges, load imbalance " << q.load_imbalance
+        << ", vertex imbalance " << q.vertex_imbalance << endl;
+}
+
+// Streams the layer into num_parts parts and prints the cut and balance,
+// next to those of the METIS partition in metis_part_file when it exists.
+// Returns an empty vector if the graph file cannot be read. The report goes
+// to `out`.
+vector<int> partitionLayer(const string& gtype, const string& graph_file, const string& metis_part_file,
+                           bool weighted, int num_parts, Partitioner method, ostream& out = cout) {
+    vector<int> node_to_partition;
+    StreamGraph g;
+    double start = omp_get_wtime();
+    if (!loadStreamGraph(graph_file, weighted, g)) return node_to_partition;
+    double loaded = omp_get_wtime();
+    node_to_partition = streamPartition(g, num_parts, method);
+    double done = omp_get_wtime();
+
+    out << "\nPartition for Graph: " << gtype << " -> " << partitionerName(method) << " into "
+        << num_parts << " parts in " << done - loaded << " s (graph read in " << loaded - start << " s)" << endl;
+    printPartitionQuality(gtype, partitionerName(method), partitionQuality(g, node_to_partition, num_parts), out);
+    if (filesystem::exists(metis_part_file)) {
+        vector<int> metis = loadPartitions(metis_part_file, num_parts);
+        printPartitionQuality(gtype, "metis", partitionQuality(g, metis, num_parts), out);
+    }
+    return node_to_partition;
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <mutex>
+
+#include "load_graph.h"
+
+using namespace std;
+
+// Built-in instrumentation: wall time per pipeline phase, event counters and
+// per-thread busy time, written as one JSON report per run. It is compiled in
+// by default; build with -DNO_PROFILE to turn every hook into a no-op.
+#ifdef NO_PROFILE
+const bool PROFILE_ENABLED = false;
+#else
+const bool PROFILE_ENABLED = true;
+#endif
+
+enum class Phase { MappingLoad, GraphParse, NeighborBuild, Scoring, TopK, MpiGather, Partition };
+const int PHASE_COUNT = 7;
+const char* const PHASE_NAMES[PHASE_COUNT] = {
+    "mapping_load", "graph_parse", "neighbor_build", "scoring", "top_k", "mpi_gather", "partition"
+};
+
+// Intersections: neighbor-set intersections (or sketch comparisons) run.
+// Comparisons: elements the chosen intersection kernel may compare, an upper
+// bound from the list lengths. SkippedEdges: edges to a ghost vertex with no
+// halo row, which contribute nothing to the score.
+enum class Counter { Intersections, Comparisons, SkippedEdges };
+const int COUNTER_COUNT = 3;
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {"intersections", "comparisons", "skipped_edges"};
+
+// One slot per thread, padded so threads never write the same cache line.
+struct alignas(64) ProfileSlot {
+    long long counters[COUNTER_COUNT] = {};
+    double busy_seconds = 0.0;
+};
+
+struct Profile {
+    double phase_seconds[PHASE_COUNT] = {};
+    vector<ProfileSlot> slots;
+    mutex phase_lock;  // phases may be timed from a loader thread too
+
+    // Sized for the default team; threads beyond it share slots modulo size
+    Profile() : slots(max(1, omp_get_max_threads())) {}
+
+    ProfileSlot& slot() { return slots[omp_get_thread_num() % slots.size()]; }
+
+    // Flat form gathered across ranks: phase seconds, counter totals, the
+    // number of threads, then each thread's busy time.
+    vector<double> pack() const {
+        vector<double> packed(phase_seconds, phase_seconds + PHASE_COUNT);
+        for (int c = 0; c < COUNTER_COUNT; ++c) {
+            long long total = 0;
+            for (const ProfileSlot& s : slots) total += s.counters[c];
+            packed.push_back(static_cast<double>(total));
+        }
+        packed.push_back(static_cast<double>(slots.size()));
+        for (const ProfileSlot& s : slots) packed.push_back(s.busy_seconds);
+        return packed;
+    }
+};
+
+inline Profile& profile() {
+    static Profile p;
+    return p;
+}
+
+// Adds the lifetime of the object to a phase. Phases are timed outside
+// parallel regions, from the driver's main thread or a loader thread.
+struct PhaseTimer {
+    Phase phase;
+    double start;
+
+    explicit PhaseTimer(Phase p) : phase(p), start(PROFILE_ENABLED ? omp_get_wtime() : 0.0) {}
+    ~PhaseTimer() {
+        if (!PROFILE_ENABLED) return;
+        double seconds = omp_get_wtime() - start;
+        lock_guard<mutex> guard(profile().phase_lock);
+        profile().phase_seconds[static_cast<int>(phase)] += seconds;
+    }
+};
+
+// Adds a batch of events to the calling thread's counters. Kernels count into
+// locals and call this once per row or task.
+inline void profileCount(long long intersections, long long comparisons, long long skipped) {
+    if (!PROFILE_ENABLED) return;
+    ProfileSlot& s = profile().slot();
+    s.counters[static_cast<int>(Counter::Intersections)] += intersections;
+    s.counters[static_cast<int>(Counter::Comparisons)] += comparisons;
+    s.counters[static_cast<int>(Counter::SkippedEdges)] += skipped;
+}
+
+inline void profileBusy(double seconds) {
+    if (!PROFILE_ENABLED) return;
+    profile().slot().busy_seconds += seconds;
+}
+
+namespace profile_detail {
+
+struct Summary {
+    double min = 0.0, max = 0.0, mean = 0.0;
+};
+
+inline Summary summarize(const vector<double>& values) {
+    Summary s;
+    if (values.empty()) return s;
+    s.min = *min_element(values.begin(), values.end());
+    s.max = *max_element(values.begin(), values.end());
+    for (double v : values) s.mean += v;
+    s.mean /= values.size();
+    return s;
+}
+
+inline void writeSeries(ofstream& out, const vector<double>& values) {
+    Summary s = summarize(values);
+    double total = 0.0;
+    for (double v : values) total += v;
+    out << "{\"min\": " << s.min << ", \"max\": " << s.max << ", \"mean\": " << s.mean
+        << ", \"total\": " << total << ", \"imbalance\": " << (s.mean > 0 ? s.max / s.mean : 1.0)
+        << ", \"per_rank\": [";
+    for (size_t i = 0; i < values.size(); ++i) out << (i ? ", " : "") << values[i];
+    out << "]}";
+}
+
+}
+
+// Writes the report for one run from every rank's pack(), in rank order.
+// Phases and counters get min/max/mean over ranks; thread busy time gets
+// them over every thread of every rank, plus each rank's own list.
+bool writeProfileJson(const string& path, const string& program,
+                      const vector<vector<double>>& ranks) {
+    using namespace profile_detail;
+    ofstream out(path);
+    if (!out) {
+        cerr << "Error: Cannot write profile: " << path << endl;
+        return false;
+    }
+    out.precision(9);
+
+    out << "{\n  \"program\": \"" << program << "\",\n  \"ranks\": " << ranks.size()
+        << ",\n  \"phases_s\": {\n";
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        vector<double> values;
+        for (const auto& r : ranks) values.push_back(r[p]);
+        out << "    \"" << PHASE_NAMES[p] << "\": ";
+        writeSeries(out, values);
+        out << (p + 1 < PHASE_COUNT ? ",\n" : "\n");
+    }
+    out << "  },\n  \"counters\": {\n";
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        vector<double> values;
+        for (const auto& r : ranks) values.push_back(r[PHASE_COUNT + c]);
+        out << "    \"" << COUNTER_NAMES[c] << "\": ";
+        writeSeries(out, values);
+        out << (c + 1 < COUNTER_COUNT ? ",\n" : "\n");
+    }
+
+    vector<double> all_threads;
+    out << "  },\n  \"thread_busy_s\": {\n    \"per_rank\": [";
+    for (size_t r = 0; r < ranks.size(); ++r) {
+        size_t first = PHASE_COUNT + COUNTER_COUNT + 1;
+        size_t count = static_cast<size_t>(ranks[r][first - 1]);
+        out << (r ? ", " : "") << "[";
+        for (size_t t = 0; t < count; ++t) {
+            out << (t ? ", " : "") << ranks[r][first + t];
+            all_threads.push_back(ranks[r][first + t]);
+        }
+        out << "]";
+    }
+    Summary s = summarize(all_threads);
+    out << "],\n    \"min\": " << s.min << ", \"max\": " << s.max << ", \"mean\": " << s.mean
+        << ", \"imbalance\": " << (s.mean > 0 ? s.max / s.mean : 1.0) << "\n  }\n}\n";
+    return static_cast<bool>(out);
+}
+
+#endif
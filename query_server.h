@@ -0,0 +1,390 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "load_graph.h"
+#include "binary_graph.h"
+#include "Influence.h"
+#include "Top-k.h"
+#include "score_cache.h"
+
+using namespace std;
+
+// Resident form of the per-layer scores for answering many top-K queries.
+// Every user that appears in any layer gets a position; each layer keeps a
+// dense score array over the positions (0 where the user is absent) and the
+// positions in rankedBefore order, so a query reads the best users first and
+// stops as soon as no unread user can enter its top-K. Snapshots are never
+// modified once built; a reload builds a new one and swaps the pointer.
+struct InfluenceSnapshot {
+    vector<int> ids;                      // real-world IDs, ascending
+    unordered_map<int, int> index;        // real-world ID -> position
+    vector<vector<double>> scores;        // [layer][position]
+    vector<vector<int>> ranked;           // [layer] positions, best first
+    vector<bool> loaded;                  // layer files were found
+    uint64_t generation = 0;
+    double load_seconds = 0.0;
+
+    int numUsers() const { return static_cast<int>(ids.size()); }
+};
+
+struct ServerConfig {
+    int num_parts = NUM_PARTS;
+    ScoreOptions options;
+    string cache_dir = "cache";
+    bool use_cache = true;
+};
+
+// Merged scores of one layer by real-world ID, as computed by the serial
+// driver with the METIS partition and the plain layout. The score cache is
+// shared with serialVersion, so either one can fill it for the other.
+// `source` is set to "cache" or "scored". Returns false if the layer's files
+// are missing.
+bool loadLayerScores(const string& gtype, const ServerConfig& config,
+                     unordered_map<int, double>& merged, string& source) {
+    string base = "higgs-" + gtype + "_network";
+    string graph_path = "graphs/" + base + ".graph";
+    string part_path = "gparts/" + base + ".graph.part." + to_string(config.num_parts);
+    string map_path = "gparts/" + base + ".graph.mapping.txt";
+    bool use_mapping = (gtype != "social");
+    string bin_path = binaryGraphPath(graph_path, config.num_parts);
+    bool have_text = filesystem::exists(graph_path) && filesystem::exists(part_path) &&
+                     (!use_mapping || filesystem::exists(map_path));
+    if (!have_text && !filesystem::exists(bin_path)) return false;
+
+    uint64_t cache_key = 0;
+    string cache_path;
+    if (config.use_cache) {
+        vector<string> inputs = {graph_path, part_path, use_mapping ? map_path : ""};
+        if (!have_text) inputs = {bin_path};
+        cache_key = scoreCacheKey(inputs, scoreCacheParams(config.options, AdjacencyLayout::Plain,
+                                                           Partitioner::Metis, config.num_parts));
+        cache_path = scoreCachePath(config.cache_dir, base, cache_key);
+        if (loadScoreCache(cache_path, cache_key, merged)) {
+            source = "cache";
+            return true;
+        }
+    }
+
+    vector<CSRGraph> subgraphs(config.num_parts);
+    vector<int> mapping;
+    if (!loadBinaryGraph(bin_path, graph_path, part_path, use_mapping ? map_path : "", subgraphs, mapping)) {
+        if (!have_text) return false;
+        if (use_mapping) {
+            mapping = loadMapping(map_path);
+            if (mapping.empty()) return false;
+        }
+        loadGraph(graph_path, part_path, subgraphs, use_mapping);
+    }
+    attachHalos(subgraphs);
+
+    merged.clear();
+    for (const CSRGraph& subgraph : subgraphs) {
+        vector<double> scores = computeInfluenceScores(subgraph, config.options);
+        for (int v = 0; v < subgraph.num_local; ++v) {
+            int realNode = realNodeId(mapping, subgraph.vertex_ids[v]);
+            merged[realNode] = max(merged[realNode], scores[v]);
+        }
+    }
+    if (!cache_path.empty()) writeScoreCache(cache_path, cache_key, merged);
+    source = "scored";
+    return true;
+}
+
+// Loads every layer and indexes it. Progress goes to `log`.
+shared_ptr<const InfluenceSnapshot> buildSnapshot(const ServerConfig& config, uint64_t generation,
+                                                  ostream& log) {
+    auto start = chrono::steady_clock::now();
+    auto snapshot = make_shared<InfluenceSnapshot>();
+    snapshot->generation = generation;
+    size_t layers = graph_types.size();
+    vector<unordered_map<int, double>> layerScores(layers);
+    snapshot->loaded.assign(layers, false);
+    for (size_t l = 0; l < layers; ++l) {
+        string source;
+        snapshot->loaded[l] = loadLayerScores(graph_types[l], config, layerScores[l], source);
+        if (snapshot->loaded[l]) {
+            log << "Layer " << graph_types[l] << " -> " << layerScores[l].size() << " users ("
+                << source << ")" << endl;
+        } else {
+            log << "Warning: Missing file(s) for graph type: " << graph_types[l] << endl;
+        }
+    }
+
+    for (const auto& layer : layerScores) {
+        for (const auto& [id, score] : layer) snapshot->ids.push_back(id);
+    }
+    sort(snapshot->ids.begin(), snapshot->ids.end());
+    snapshot->ids.erase(unique(snapshot->ids.begin(), snapshot->ids.end()), snapshot->ids.end());
+    int n = snapshot->numUsers();
+    snapshot->index.reserve(n);
+    for (int i = 0; i < n; ++i) snapshot->index.emplace(snapshot->ids[i], i);
+
+    snapshot->scores.assign(layers, vector<double>(n, 0.0));
+    snapshot->ranked.assign(layers, vector<int>());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t l = 0; l < layers; ++l) {
+        vector<double>& scores = snapshot->scores[l];
+        for (const auto& [id, score] : layerScores[l]) scores[snapshot->index.at(id)] = score;
+        vector<int>& ranked = snapshot->ranked[l];
+        ranked.resize(n);
+        for (int i = 0; i < n; ++i) ranked[i] = i;
+        // Positions follow the IDs, so the lower position wins a tie
+        sort(ranked.begin(), ranked.end(), [&](int a, int b) {
+            return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+        });
+    }
+
+    snapshot->load_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return snapshot;
+}
+
+// How much of the snapshot a query touched.
+struct QueryStats {
+    int depth = 0;       // entries read from each ranked list
+    int evaluated = 0;   // users whose combined score was computed
+};
+
+// Combined score of one position, summed in layer order.
+inline double combinedScore(const InfluenceSnapshot& s, const vector<double>& weights, int u) {
+    double total = 0.0;
+    for (size_t l = 0; l < weights.size(); ++l) {
+        if (weights[l] != 0.0) total += weights[l] * s.scores[l][u];
+    }
+    return total;
+}
+
+// Top-k of the weighted sum of the layer scores over every user. With
+// non-negative weights the ranked lists are read in step (threshold
+// algorithm): the weighted scores at the current depth bound every unread
+// user, so the scan stops once the k-th best is above that bound. Other
+// weights fall back to a full scan. Both give the same result.
+vector<pair<int, double>> combinedTopK(const InfluenceSnapshot& s, const vector<double>& weights, int k,
+                                       QueryStats& stats) {
+    HeapTopK best(k);
+    int n = s.numUsers();
+    vector<int> active;
+    bool monotone = true;
+    for (size_t l = 0; l < weights.size(); ++l) {
+        if (weights[l] > 0.0) active.push_back(static_cast<int>(l));
+        if (weights[l] < 0.0) monotone = false;
+    }
+
+    if (!monotone || active.empty()) {
+        for (int u = 0; u < n; ++u) best.offer(s.ids[u], combinedScore(s, weights, u));
+        stats.depth = n;
+        stats.evaluated = n;
+        return best.result();
+    }
+
+    unordered_set<int> seen;
+    for (int d = 0; d < n; ++d) {
+        double threshold = 0.0;
+        for (int l : active) {
+            int u = s.ranked[l][d];
+            threshold += weights[l] * s.scores[l][u];
+            if (seen.insert(u).second) best.offer(s.ids[u], combinedScore(s, weights, u));
+        }
+        stats.depth = d + 1;
+        if (best.heap.size() == best.k && best.heap.top().second > threshold) break;
+    }
+    stats.evaluated = static_cast<int>(seen.size());
+    return best.result();
+}
+
+// Top-k of the weighted sum over the listed users only; unknown IDs are
+// skipped.
+vector<pair<int, double>> subsetTopK(const InfluenceSnapshot& s, const vector<double>& weights,
+                                     const vector<int>& users, int k, QueryStats& stats) {
+    HeapTopK best(k);
+    unordered_set<int> done;
+    for (int id : users) {
+        auto it = s.index.find(id);
+        if (it == s.index.end() || !done.insert(id).second) continue;
+        best.offer(id, combinedScore(s, weights, it->second));
+    }
+    stats.evaluated = static_cast<int>(done.size());
+    return best.result();
+}
+
+// Parses a comma-separated list of IDs. Returns false on a malformed list.
+inline bool parseIdList(const string& list, vector<int>& ids) {
+    ids.clear();
+    const char* p = list.c_str();
+    const char* end = p + list.size();
+    while (p < end) {
+        int id;
+        auto [next, ec] = from_chars(p, end, id);
+        if (ec != errc() || (next != end && *next != ',')) return false;
+        ids.push_back(id);
+        p = next == end ? end : next + 1;
+    }
+    return !ids.empty();
+}
+
+// Resident server state. Queries read the current snapshot through the
+// shared pointer, so a reload swaps in new data while queries already
+// running finish on the old one.
+struct InfluenceServer {
+    ServerConfig config;
+    int default_k = 10;
+    vector<double> default_weights = LAYER_WEIGHTS;
+    shared_ptr<const InfluenceSnapshot> snapshot;
+    mutex reload_mutex;  // one reload at a time
+};
+
+inline shared_ptr<const InfluenceSnapshot> currentSnapshot(const InfluenceServer& server) {
+    return atomic_load(&server.snapshot);
+}
+
+// top [k=N] [weights=m,rt,rp,s] [layer=NAME] [users=ID,ID,...]
+void answerTop(InfluenceServer& server, istringstream& in, ostream& reply) {
+    auto start = chrono::steady_clock::now();
+    int k = server.default_k;
+    vector<double> weights = server.default_weights;
+    vector<int> users;
+    bool subset = false;
+    string token;
+    while (in >> token) {
+        size_t eq = token.find('=');
+        string key = token.substr(0, eq);
+        string value = eq == string::npos ? "" : token.substr(eq + 1);
+        if (key == "k") {
+            auto [ptr, ec] = from_chars(value.data(), value.data() + value.size(), k);
+            if (ec != errc() || ptr != value.data() + value.size() || k < 1) {
+                reply << "ERROR k must be a positive integer" << endl;
+                return;
+            }
+        } else if (key == "weights") {
+            if (!parseLayerWeights(value, weights)) {
+                reply << "ERROR weights needs " << graph_types.size() << " comma-separated values" << endl;
+                return;
+            }
+        } else if (key == "layer") {
+            auto it = find(graph_types.begin(), graph_types.end(), value);
+            if (it == graph_types.end()) {
+                reply << "ERROR unknown layer '" << value << "'" << endl;
+                return;
+            }
+            weights.assign(graph_types.size(), 0.0);
+            weights[it - graph_types.begin()] = 1.0;
+        } else if (key == "users") {
+            if (!parseIdList(value, users)) {
+                reply << "ERROR users needs comma-separated IDs" << endl;
+                return;
+            }
+            subset = true;
+        } else {
+            reply << "ERROR unknown argument '" << token << "'" << endl;
+            return;
+        }
+    }
+
+    auto s = currentSnapshot(server);
+    QueryStats stats;
+    vector<pair<int, double>> topK = subset ? subsetTopK(*s, weights, users, k, stats)
+                                            : combinedTopK(*s, weights, k, stats);
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    for (const auto& [node, score] : topK) {
+        reply << "Node " << node << " -> Score: " << score << endl;
+    }
+    reply << "OK " << topK.size() << " results in " << micros << " us (" << stats.evaluated
+          << " users read, generation " << s->generation << ")" << endl;
+}
+
+// score ID[,ID...]
+void answerScore(InfluenceServer& server, istringstream& in, ostream& reply) {
+    string list;
+    vector<int> ids;
+    if (!(in >> list) || !parseIdList(list, ids)) {
+        reply << "ERROR score needs comma-separated IDs" << endl;
+        return;
+    }
+    auto s = currentSnapshot(server);
+    int found = 0;
+    for (int id : ids) {
+        auto it = s->index.find(id);
+        if (it == s->index.end()) continue;
+        reply << "Node " << id << " ->";
+        for (size_t l = 0; l < graph_types.size(); ++l) {
+            reply << (l ? ", " : " ") << graph_types[l] << ": " << s->scores[l][it->second];
+        }
+        reply << endl;
+        found++;
+    }
+    reply << "OK " << found << " of " << ids.size() << " users found" << endl;
+}
+
+void answerStats(InfluenceServer& server, ostream& reply) {
+    auto s = currentSnapshot(server);
+    reply << "Users: " << s->numUsers() << ", generation: " << s->generation
+          << ", loaded in " << s->load_seconds << " s" << endl;
+    for (size_t l = 0; l < graph_types.size(); ++l) {
+        reply << "Layer " << graph_types[l] << " -> " << (s->loaded[l] ? "loaded" : "missing") << endl;
+    }
+    reply << "OK" << endl;
+}
+
+// Rebuilds the snapshot from the current files. The caller waits for it;
+// other clients keep querying the old snapshot until the swap.
+void answerReload(InfluenceServer& server, ostream& reply, ostream& log) {
+    unique_lock<mutex> lock(server.reload_mutex, try_to_lock);
+    if (!lock.owns_lock()) {
+        reply << "ERROR reload already in progress" << endl;
+        return;
+    }
+    auto current = currentSnapshot(server);
+    uint64_t generation = current ? current->generation + 1 : 1;
+    auto fresh = buildSnapshot(server.config, generation, log);
+    if (fresh->numUsers() == 0) {
+        reply << "ERROR no layer could be loaded";
+        if (current) reply << ", keeping generation " << current->generation;
+        reply << endl;
+        return;
+    }
+    atomic_store(&server.snapshot, fresh);
+    reply << "OK generation " << fresh->generation << " loaded in " << fresh->load_seconds << " s" << endl;
+}
+
+// Line protocol shared by stdin and socket clients: one request per line,
+// answered by zero or more result lines and then one line starting with "OK"
+// or "ERROR". Returns false when the client asked to quit.
+//
+//   top [k=N] [weights=m,rt,rp,s] [layer=NAME] [users=ID,ID,...]
+//   score ID[,ID...]
+//   stats
+//   reload
+//   quit
+bool handleRequest(InfluenceServer& server, const string& line, ostream& reply, ostream& log) {
+    istringstream in(line);
+    string command;
+    if (!(in >> command)) return true;
+    if (command == "top") {
+        answerTop(server, in, reply);
+    } else if (command == "score") {
+        answerScore(server, in, reply);
+    } else if (command == "stats") {
+        answerStats(server, reply);
+    } else if (command == "reload") {
+        answerReload(server, reply, log);
+    } else if (command == "quit") {
+        reply << "OK bye" << endl;
+        return false;
+    } else {
+        reply << "ERROR unknown command '" << command << "' (top, score, stats, reload, quit)" << endl;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+
+#include "load_graph.h"
+
+using namespace std;
+
+// Optional relabeling of the vertices of a partition before scoring. Local
+// IDs follow METIS numbering, so the rows a vertex's intersections read are
+// spread over the whole neighbor array. `degree` puts the vertices in order
+// of decreasing degree, so the hub rows that most intersections read sit
+// together. `rcm` (reverse Cuthill-McKee) numbers vertices in breadth-first
+// order from a low-degree vertex of each component, so neighbors get nearby
+// IDs. Ghosts follow the first local row that reaches them. vertex_ids still
+// maps every local ID to its METIS ID, so scores map back unchanged.
+enum class VertexOrder { None, Degree, Rcm };
+
+VertexOrder parseVertexOrder(const string& name) {
+    if (name == "degree") return VertexOrder::Degree;
+    if (name == "rcm") return VertexOrder::Rcm;
+    if (name != "none") cerr << "Warning: Unknown vertex order '" << name << "', using none" << endl;
+    return VertexOrder::None;
+}
+
+inline const char* vertexOrderName(VertexOrder order) {
+    return order == VertexOrder::Degree ? "degree" : order == VertexOrder::Rcm ? "rcm" : "none";
+}
+
+// Model cache for estimateRowMissRate: 512 KB of 64-byte lines, 8-way set
+// associative with LRU replacement.
+const int REORDER_CACHE_BYTES = 512 * 1024;
+const int REORDER_CACHE_WAYS = 8;
+const int REORDER_LINE_BYTES = 64;
+
+// Local vertices by decreasing degree, ties by local ID.
+vector<int> degreeOrder(const CSRGraph& graph) {
+    vector<int> order(graph.num_local);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return graph.degree(a) > graph.degree(b);
+    });
+    return order;
+}
+
+// Reverse Cuthill-McKee over the edges between local vertices. Each
+// component starts from its lowest-degree unvisited vertex, and the
+// neighbors of a vertex are queued by increasing degree.
+vector<int> rcmOrder(const CSRGraph& graph) {
+    int n = graph.num_local;
+    auto lighter = [&](int a, int b) {
+        return graph.degree(a) != graph.degree(b) ? graph.degree(a) < graph.degree(b) : a < b;
+    };
+    vector<int> starts(n);
+    iota(starts.begin(), starts.end(), 0);
+    sort(starts.begin(), starts.end(), lighter);
+
+    vector<int> order;
+    order.reserve(n);
+    vector<char> visited(n, 0);
+    vector<int> next;
+    for (int s : starts) {
+        if (visited[s]) continue;
+        visited[s] = 1;
+        order.push_back(s);
+        for (size_t head = order.size() - 1; head < order.size(); ++head) {
+            int v = order[head];
+            next.clear();
+            for (int64_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                int u = graph.neighbors[e];
+                if (u < n && !visited[u]) {
+                    visited[u] = 1;
+                    next.push_back(u);
+                }
+            }
+            sort(next.begin(), next.end(), lighter);
+            order.insert(order.end(), next.begin(), next.end());
+        }
+    }
+    reverse(order.begin(), order.end());
+    return order;
+}
+
+vector<int> vertexOrder(const CSRGraph& graph, VertexOrder method) {
+    if (method == VertexOrder::Degree) return degreeOrder(graph);
+    if (method == VertexOrder::Rcm) return rcmOrder(graph);
+    vector<int> order(graph.num_local);
+    iota(order.begin(), order.end(), 0);
+    return order;
+}
+
+// Renumbers `graph` so that local vertex order[i] becomes local i. Ghosts are
+// numbered in the order the new rows first reach them. Rows and halo rows are
+// relabeled and sorted again, with weights kept alongside.
+void relabelGraph(CSRGraph& graph, const vector<int>& order) {
+    int n = graph.num_local;
+    int total = graph.numVertices();
+    vector<int> new_id(total, -1);
+    for (int i = 0; i < n; ++i) new_id[order[i]] = i;
+    int next = n;
+    for (int i = 0; i < n; ++i) {
+        for (int64_t e = graph.offsets[order[i]]; e < graph.offsets[order[i] + 1]; ++e) {
+            int u = graph.neighbors[e];
+            if (new_id[u] < 0) new_id[u] = next++;
+        }
+    }
+    for (int u = n; u < total; ++u) {
+        if (new_id[u] < 0) new_id[u] = next++;
+    }
+
+    CSRGraph out;
+    out.num_local = n;
+    out.vertex_ids.resize(total);
+    for (int u = 0; u < total; ++u) out.vertex_ids[new_id[u]] = graph.vertex_ids[u];
+    out.offsets.assign(n + 1, 0);
+    for (int i = 0; i < n; ++i) out.offsets[i + 1] = out.offsets[i] + graph.degree(order[i]);
+    out.neighbors.resize(graph.neighbors.size());
+    out.weights.resize(graph.weights.size());
+
+    #pragma omp parallel
+    {
+        vector<pair<int, int>> row;
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < n; ++i) {
+            int v = order[i];
+            row.clear();
+            for (int64_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                row.emplace_back(new_id[graph.neighbors[e]], graph.weights[e]);
+            }
+            sort(row.begin(), row.end());
+            int64_t base = out.offsets[i];
+            for (size_t k = 0; k < row.size(); ++k) {
+                out.neighbors[base + k] = row[k].first;
+                out.weights[base + k] = row[k].second;
+            }
+        }
+    }
+
+    if (graph.hasHalo()) {
+        int ghosts = graph.numGhosts();
+        vector<int> old_ghost(ghosts);
+        for (int g = 0; g < ghosts; ++g) old_ghost[new_id[n + g] - n] = g;
+        out.halo_offsets.assign(ghosts + 1, 0);
+        out.halo_degrees.resize(ghosts);
+        for (int g = 0; g < ghosts; ++g) {
+            int old = old_ghost[g];
+            out.halo_offsets[g + 1] = out.halo_offsets[g] + (graph.halo_offsets[old + 1] - graph.halo_offsets[old]);
+            out.halo_degrees[g] = graph.halo_degrees[old];
+        }
+        out.halo_neighbors.resize(graph.halo_neighbors.size());
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int g = 0; g < ghosts; ++g) {
+            int old = old_ghost[g];
+            int* dst = out.halo_neighbors.data() + out.halo_offsets[g];
+            int64_t len = graph.halo_offsets[old + 1] - graph.halo_offsets[old];
+            for (int64_t k = 0; k < len; ++k) {
+                dst[k] = new_id[graph.halo_neighbors[graph.halo_offsets[old] + k]];
+            }
+            sort(dst, dst + len);
+        }
+    }
+    graph = move(out);
+}
+
+// Relabels `graph` with the chosen order; None leaves it untouched.
+void reorderGraph(CSRGraph& graph, VertexOrder method) {
+    if (method == VertexOrder::None) return;
+    relabelGraph(graph, vertexOrder(graph, method));
+}
+
+// Share of neighbor-row lookups that miss in the model cache when the
+// kernel walks the vertices in local ID order: for every edge it reads the
+// neighbor's row pointer and the first line of its row. This depends only on
+// the numbering, so it compares orders without hardware counters.
+double estimateRowMissRate(const CSRGraph& graph) {
+    const int sets = REORDER_CACHE_BYTES / REORDER_LINE_BYTES / REORDER_CACHE_WAYS;
+    vector<uint64_t> tags(static_cast<size_t>(sets) * REORDER_CACHE_WAYS, ~0ULL);
+    int64_t accesses = 0, misses = 0;
+
+    // Move-to-front within the set keeps it in LRU order
+    auto touch = [&](uint64_t line) {
+        uint64_t* set = tags.data() + (line % sets) * REORDER_CACHE_WAYS;
+        int way = 0;
+        while (way < REORDER_CACHE_WAYS - 1 && set[way] != line) way++;
+        if (set[way] != line) misses++;
+        for (; way > 0; --way) set[way] = set[way - 1];
+        set[0] = line;
+        accesses++;
+    };
+
+    // Separate address ranges for the row pointers, rows and halo rows
+    const uint64_t offsets_base = 0, rows_base = 1ULL << 40, halo_base = 2ULL << 40;
+    for (int v = 0; v < graph.num_local; ++v) {
+        for (int64_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+            int u = graph.neighbors[e];
+            if (graph.isLocal(u)) {
+                touch((offsets_base + u * sizeof(int64_t)) / REORDER_LINE_BYTES);
+                touch((rows_base + graph.offsets[u] * sizeof(int)) / REORDER_LINE_BYTES);
+            } else if (graph.hasHalo()) {
+                int g = u - graph.num_local;
+                touch((offsets_base + (graph.num_local + g) * sizeof(int64_t)) / REORDER_LINE_BYTES);
+                touch((halo_base + graph.halo_offsets[g] * sizeof(int)) / REORDER_LINE_BYTES);
+            }
+        }
+    }
+    return accesses > 0 ? static_cast<double>(misses) / accesses : 0.0;
+}
+
+#endif
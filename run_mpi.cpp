@@ -1,5 +1,8 @@
-// mpic++ -std=c++17 -O2 -o run_mpi run_mpi.cpp
-// mpirun --hostfile machinefile -np 8 ./run_mpi
+// mpic++ -std=c++17 -O2 -fopenmp -o run_mpi run_mpi.cpp
+// mpirun --hostfile machinefile -np 8 ./run_mpi [--parts N] [--schedule static|dynamic]
+//        [--omp-schedule static|dynamic|degree] [--engine vertex|edge|minhash]
+//        [--sketch-size K] [--profile FILE] [--partitioner metis|ldg|fennel]
+//        [--top-k K] [--weights m,rt,rp,s] [--no-pipeline] [--reorder none|degree|rcm]
 
 #include <mpi.h>
 #include <iostream>
@@ -9,167 +12,935 @@
 #include <string>
 #include <algorithm>
 #include <filesystem>
+#include <chrono>
+#include <future>
+#include <sstream>
+#include <cstdlib>
 #include "load_graph.h"
+#include "binary_graph.h"
 #include "Influence.h"
 #include "Top-k.h"
+#include "profile.h"
+#include "partitioner.h"
+#include "reorder.h"
 
 using namespace std;
 
-// Define NUM_PARTS, adjust it based on the number of processes you are running.
-#define NUM_PARTS 8
 #define K 10
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+struct HaloStats {
+    long long ghosts = 0;       // ghost vertices whose rows were requested
+    long long peers = 0;        // ranks sharing cut edges with this one
+    long long sent_ints = 0;    // ints sent (requests + replies)
+    long long recv_ints = 0;    // ints received (requests + replies)
+};
 
+// Fetches the neighbor list of every ghost vertex of `graph` from the rank that
+// owns its partition (part_owner) and installs it as the halo, so cut edges are
+// scored instead of skipped. Ranks sharing cut edges form a distributed graph
+// topology; ghost IDs go out and packed rows (degree, METIS IDs) come back in
+// two rounds of MPI_Neighbor_alltoallv.
+HaloStats exchangeHalo(CSRGraph& graph,
+                       const vector<int>& node_to_partition,
+                       const vector<int>& part_owner,
+                       MPI_Comm comm) {
     int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
 
-    if (size != NUM_PARTS) {
-        if (rank == 0) {
-            cerr << "This program must be run with " << NUM_PARTS << " processes." << endl;
-        }
-        MPI_Finalize();
-        return 1;
+    HaloStats stats;
+    stats.ghosts = graph.numGhosts();
+
+    // Group ghost IDs by owner, keeping local ID order within each owner
+    vector<int> ghost_owner(graph.numGhosts(), -1);
+    vector<vector<int>> requests(size);
+    for (int g = 0; g < graph.numGhosts(); ++g) {
+        int id = graph.vertex_ids[graph.num_local + g];
+        if (id < 1 || id > static_cast<int>(node_to_partition.size())) continue;
+        int owner = part_owner[node_to_partition[id - 1]];
+        if (owner == rank) continue;
+        ghost_owner[g] = owner;
+        requests[owner].push_back(id);
     }
 
-    // Final aggregated data (only used by Rank 0)
-    unordered_map<int, vector<double>> allNodeScores;
-    unordered_map<string, int> gtypeIndex = {
-        {"mention", 0}, {"retweet", 1}, {"reply", 2}, {"social", 3}
+    vector<int> req_counts(size), in_counts(size);
+    for (int r = 0; r < size; ++r) req_counts[r] = static_cast<int>(requests[r].size());
+    MPI_Alltoall(req_counts.data(), 1, MPI_INT, in_counts.data(), 1, MPI_INT, comm);
+
+    vector<int> peers;
+    for (int r = 0; r < size; ++r) {
+        if (r != rank && (req_counts[r] > 0 || in_counts[r] > 0)) peers.push_back(r);
+    }
+    stats.peers = static_cast<long long>(peers.size());
+    int np = static_cast<int>(peers.size());
+
+    MPI_Comm halo_comm;
+    MPI_Dist_graph_create_adjacent(comm, np, peers.data(), MPI_UNWEIGHTED,
+                                   np, peers.data(), MPI_UNWEIGHTED,
+                                   MPI_INFO_NULL, 0, &halo_comm);
+
+    auto displacements = [](const vector<int>& counts) {
+        vector<int> displs(counts.size() + 1, 0);
+        for (size_t i = 0; i < counts.size(); ++i) displs[i + 1] = displs[i] + counts[i];
+        return displs;
     };
 
-    for (const auto& gtype : graph_types) {
-        string base = "higgs-" + gtype + "_network";
-        string graph_path = "graphs/" + base + ".graph";
-        string part_path = "gparts/" + base + ".graph.part.8";
-        string map_path = "gparts/" + base + ".graph.mapping.txt";
-        bool use_mapping = (gtype != "social");
+    // Round 1: ghost IDs to their owners
+    vector<int> send_counts(np), recv_counts(np);
+    vector<int> send_ids;
+    for (int i = 0; i < np; ++i) {
+        send_counts[i] = req_counts[peers[i]];
+        recv_counts[i] = in_counts[peers[i]];
+        send_ids.insert(send_ids.end(), requests[peers[i]].begin(), requests[peers[i]].end());
+    }
+    vector<int> send_displs = displacements(send_counts), recv_displs = displacements(recv_counts);
+    vector<int> recv_ids(recv_displs[np]);
+    MPI_Neighbor_alltoallv(send_ids.data(), send_counts.data(), send_displs.data(), MPI_INT,
+                           recv_ids.data(), recv_counts.data(), recv_displs.data(), MPI_INT,
+                           halo_comm);
+
+    // Answer with the full row of each requested vertex
+    int max_id = 0;
+    for (int v = 0; v < graph.num_local; ++v) max_id = max(max_id, graph.vertex_ids[v]);
+    vector<int> local_of(max_id + 1, -1);
+    for (int v = 0; v < graph.num_local; ++v) local_of[graph.vertex_ids[v]] = v;
 
-        if (!filesystem::exists(graph_path) || !filesystem::exists(part_path) ||
-            (use_mapping && !filesystem::exists(map_path))) {
-            if (rank == 0) {
-                cerr << "Missing file(s) for graph type: " << gtype << endl;
+    vector<int> reply, reply_counts(np);
+    for (int i = 0; i < np; ++i) {
+        size_t start = reply.size();
+        for (int k = recv_displs[i]; k < recv_displs[i + 1]; ++k) {
+            int id = recv_ids[k];
+            int v = (id >= 0 && id <= max_id) ? local_of[id] : -1;
+            if (v < 0) {
+                reply.push_back(0);
+                continue;
             }
+            reply.push_back(graph.degree(v));
+            for (int e = 0; e < graph.degree(v); ++e) {
+                reply.push_back(graph.vertex_ids[graph.row(v)[e]]);
+            }
+        }
+        reply_counts[i] = static_cast<int>(reply.size() - start);
+    }
+
+    // Round 2: packed rows back to the requesters
+    vector<int> row_counts(np);
+    MPI_Neighbor_alltoall(reply_counts.data(), 1, MPI_INT, row_counts.data(), 1, MPI_INT, halo_comm);
+    vector<int> reply_displs = displacements(reply_counts), row_displs = displacements(row_counts);
+    vector<int> rows(row_displs[np]);
+    MPI_Neighbor_alltoallv(reply.data(), reply_counts.data(), reply_displs.data(), MPI_INT,
+                           rows.data(), row_counts.data(), row_displs.data(), MPI_INT,
+                           halo_comm);
+    MPI_Comm_free(&halo_comm);
+
+    stats.sent_ints = send_displs[np] + reply_displs[np];
+    stats.recv_ints = recv_displs[np] + row_displs[np];
+
+    // Reassemble the replies in ghost order for setHalo
+    vector<int> peer_index(size, -1);
+    for (int i = 0; i < np; ++i) peer_index[peers[i]] = i;
+    vector<int> cursor(row_displs.begin(), row_displs.end() - 1);
+    vector<int> packed;
+    for (int g = 0; g < graph.numGhosts(); ++g) {
+        if (ghost_owner[g] < 0) {
+            packed.push_back(0);
             continue;
         }
+        int& pos = cursor[peer_index[ghost_owner[g]]];
+        int deg = rows[pos];
+        packed.insert(packed.end(), rows.begin() + pos, rows.begin() + pos + 1 + deg);
+        pos += 1 + deg;
+    }
+    setHalo(graph, packed);
+    return stats;
+}
+
+struct LayerFiles {
+    string graph, part, map, bin;
+    bool use_mapping;
+    bool have_text;
+};
+
+// Loads the union of `parts` as this rank's graph, from the binary container
+// when there is one and it is valid, and from METIS text otherwise. With `with_halo` the ghost
+// rows are read from the same source. node_to_partition is filled if empty;
+// the mapping is read only when `mapping` is non-null. With a non-null
+// `line_index`, text input is indexed once (when the index is still empty)
+// and later calls parse only the lines they need. Returns 1 on success,
+// 0 if the mapping could not be read and -1 if the inputs are missing or the
+// graph file cannot be read.
+int loadRankGraph(const LayerFiles& files,
+                  const vector<int>& parts,
+                  int num_parts,
+                  bool with_halo,
+                  CSRGraph& graph,
+                  vector<int>* mapping,
+                  vector<int>& node_to_partition,
+                  MetisLineIndex* line_index = nullptr) {
+    if (!files.bin.empty()) {
+        PhaseTimer timer(Phase::GraphParse);
+        if (loadBinaryGraphParts(files.bin, files.graph, files.part, files.use_mapping ? files.map : "",
+                                 parts, num_parts, graph, mapping,
+                                 node_to_partition.empty() ? &node_to_partition : nullptr, with_halo)) {
+            return 1;
+        }
+    }
+    if (!files.have_text) return -1;
+
+    if (node_to_partition.empty()) {
+        PhaseTimer timer(Phase::GraphParse);
+        node_to_partition = loadPartitions(files.part, num_parts);
+    }
+    if (mapping && files.use_mapping) {
+        PhaseTimer timer(Phase::MappingLoad);
+        *mapping = loadMapping(files.map);
+        if (mapping->empty()) return 0;
+    }
+    // A sidecar index from convert_binary lets the rank read only its own
+    // lines; the dynamic schedule builds one in memory if there is none
+    MetisLineIndex own_index;
+    if (!line_index && !parts.empty()) {
+        PhaseTimer timer(Phase::GraphParse);
+        if (loadLineIndex(files.graph, own_index)) line_index = &own_index;
+    }
+    if (line_index && line_index->empty()) {
+        PhaseTimer timer(Phase::GraphParse);
+        if (!loadLineIndex(files.graph, *line_index) && !buildLineIndex(files.graph, *line_index)) {
+            return -1;
+        }
+    }
+    if (!parts.empty()) {
+        {
+            PhaseTimer timer(Phase::GraphParse);
+            if (!loadGraphParts(files.graph, node_to_partition, parts, num_parts, graph, files.use_mapping,
+                                line_index)) {
+                return -1;
+            }
+        }
+        if (with_halo) {
+            PhaseTimer timer(Phase::NeighborBuild);
+            if (!loadTextHalo(files.graph, graph, files.use_mapping, line_index)) return -1;
+        }
+    }
+    return 1;
+}
+
+// Appends the local top-K of `graph` to `candidates` as (METIS ID, score) and
+// adds weight * score of every local vertex to the entry of its real ID in
+// `partial`, this rank's share of the combined multi-layer score.
+void scoreGraph(const CSRGraph& graph, const ScoreOptions& options,
+                const vector<int>& mapping, double weight, int k,
+                vector<pair<int, double>>& candidates,
+                unordered_map<int, double>& partial) {
+    vector<double> scores;
+    {
+        PhaseTimer timer(Phase::Scoring);
+        scores = computeInfluenceScores(graph, options);
+    }
+    PhaseTimer timer(Phase::TopK);
+    vector<pair<int, double>> topK = getTopKInfluencers<K>(graph, scores, k);
+    candidates.insert(candidates.end(), topK.begin(), topK.end());
+    for (int v = 0; v < graph.num_local; ++v) {
+        partial[realNodeId(mapping, graph.vertex_ids[v])] += weight * scores[v];
+    }
+}
+
+// Gathers every rank's (ID, score) pairs on rank 0, in rank order.
+int gatherPairs(const vector<pair<int, double>>& local,
+                vector<pair<int, double>>& all,
+                MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // Ranks may hold any number of pairs, so gather counts first
+    vector<double> packedLocal(2 * local.size());
+    for (size_t i = 0; i < local.size(); ++i) {
+        packedLocal[2 * i] = static_cast<double>(local[i].first);
+        packedLocal[2 * i + 1] = local[i].second;
+    }
+    int packedCount = static_cast<int>(packedLocal.size());
+    vector<int> allCounts(rank == 0 ? size : 0), allDispls(rank == 0 ? size + 1 : 0, 0);
+    MPI_Gather(&packedCount, 1, MPI_INT, allCounts.data(), 1, MPI_INT, 0, comm);
+
+    vector<double> allPacked;
+    if (rank == 0) {
+        for (int r = 0; r < size; ++r) allDispls[r + 1] = allDispls[r] + allCounts[r];
+        allPacked.resize(allDispls[size]);
+    }
+    int status = MPI_Gatherv(packedLocal.data(), packedCount, MPI_DOUBLE,
+                             allPacked.data(), allCounts.data(), allDispls.data(), MPI_DOUBLE,
+                             0, comm);
+
+    all.clear();
+    for (size_t i = 0; i < allPacked.size() / 2; ++i) {
+        all.emplace_back(static_cast<int>(allPacked[2 * i]), allPacked[2 * i + 1]);
+    }
+    return status;
+}
+
+struct TopKStats {
+    long long first_round = 0;  // pairs sent in round 1 (local top-K)
+    long long second_round = 0; // pairs sent in round 2 (above the threshold)
+    long long verified = 0;     // candidates whose exact sum was fetched
+    bool full_gather = false;   // a negative partial forced a plain gather
+};
+
+// K-th largest value of `sums`, or 0 when there are fewer than k.
+double kthLargest(const unordered_map<int, double>& sums, int k) {
+    if (static_cast<int>(sums.size()) < k) return 0.0;
+    vector<double> values;
+    for (const auto& [id, sum] : sums) values.push_back(sum);
+    nth_element(values.begin(), values.begin() + (k - 1), values.end(), greater<double>());
+    return values[k - 1];
+}
+
+// Exact top-k of sum over ranks of partial[id], with every partial >= 0,
+// using the three-round uniform threshold protocol (TPUT):
+//   1. every rank sends its local top-k; the k-th best partial sum on rank 0
+//      is a lower bound tau1 on the k-th best total
+//   2. every rank sends its remaining entries >= tau1 / size; an ID not
+//      reported by a rank is below tau1 / size there, which bounds each total
+//      from above, and IDs whose bound falls under the new k-th best lower
+//      bound tau2 are dropped
+//   3. the exact totals of the surviving candidates are fetched from all ranks
+// Pairs sent stay close to k * size on skewed score distributions. The result
+// (highest total first, ties by ID) is returned on rank 0.
+//
+// The bounds only hold for non-negative partials. If any rank holds a
+// negative one (a negative --weights entry), every pair is gathered and
+// summed on rank 0 instead, in the same rank order.
+vector<pair<int, double>> distributedTopK(const unordered_map<int, double>& partial,
+                                          int k, MPI_Comm comm, TopKStats& stats) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    int negative = 0;
+    for (const auto& [id, score] : partial) {
+        if (score < 0.0) {
+            negative = 1;
+            break;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &negative, 1, MPI_INT, MPI_LOR, comm);
+    if (negative) {
+        vector<pair<int, double>> all(partial.begin(), partial.end()), received;
+        gatherPairs(all, received, comm);
+        stats.full_gather = true;
+        stats.first_round = static_cast<long long>(received.size());
+        unordered_map<int, double> totals;
+        for (const auto& [id, score] : received) totals[id] += score;
+        return rank == 0 ? getTopKInfluencers(totals, k) : vector<pair<int, double>>();
+    }
+
+    // Round 1: local top-k, selected in parallel from a dense copy of the map
+    vector<int> ids;
+    vector<double> scores;
+    ids.reserve(partial.size());
+    scores.reserve(partial.size());
+    for (const auto& [id, score] : partial) {
+        ids.push_back(id);
+        scores.push_back(score);
+    }
+    vector<pair<int, double>> local = selectTopK<K>(scores, k, [&](int i) { return ids[i]; }), received;
+    unordered_set<int> sent;
+    for (const auto& [id, score] : local) sent.insert(id);
+    gatherPairs(local, received, comm);
+
+    unordered_map<int, double> lower;
+    unordered_map<int, int> reported;
+    for (const auto& [id, score] : received) {
+        lower[id] += score;
+        reported[id]++;
+    }
+    stats.first_round = static_cast<long long>(received.size());
+    double threshold = rank == 0 ? kthLargest(lower, k) / size : 0.0;
+    MPI_Bcast(&threshold, 1, MPI_DOUBLE, 0, comm);
+
+    // Round 2: everything else at or above the uniform threshold
+    local.clear();
+    for (const auto& [id, score] : partial) {
+        if (score >= threshold && !sent.count(id)) local.emplace_back(id, score);
+    }
+    gatherPairs(local, received, comm);
+    for (const auto& [id, score] : received) {
+        lower[id] += score;
+        reported[id]++;
+    }
+    stats.second_round = static_cast<long long>(received.size());
+
+    vector<int> candidates;
+    if (rank == 0) {
+        double tau2 = kthLargest(lower, k);
+        for (const auto& [id, sum] : lower) {
+            double upper = sum + (size - reported[id]) * threshold;
+            if (upper >= tau2) candidates.push_back(id);
+        }
+        sort(candidates.begin(), candidates.end());
+    }
+    int num_candidates = static_cast<int>(candidates.size());
+    MPI_Bcast(&num_candidates, 1, MPI_INT, 0, comm);
+    candidates.resize(num_candidates);
+    MPI_Bcast(candidates.data(), num_candidates, MPI_INT, 0, comm);
+    stats.verified = num_candidates;
+
+    // Round 3: exact totals, summed in rank order so the result is reproducible
+    vector<double> mine(num_candidates, 0.0);
+    for (int i = 0; i < num_candidates; ++i) {
+        auto it = partial.find(candidates[i]);
+        if (it != partial.end()) mine[i] = it->second;
+    }
+    vector<double> all(rank == 0 ? static_cast<size_t>(num_candidates) * size : 0);
+    MPI_Gather(mine.data(), num_candidates, MPI_DOUBLE, all.data(), num_candidates, MPI_DOUBLE, 0, comm);
+
+    vector<pair<int, double>> topK;
+    if (rank == 0) {
+        for (int i = 0; i < num_candidates; ++i) {
+            double total = 0.0;
+            for (int r = 0; r < size; ++r) total += all[static_cast<size_t>(r) * num_candidates + i];
+            topK.emplace_back(candidates[i], total);
+        }
+        sort(topK.begin(), topK.end(), rankedBefore);
+        if (static_cast<int>(topK.size()) > k) topK.resize(k);
+    }
+    return topK;
+}
+
+// A layer's inputs, read by a loader thread while the previous layer is
+// scored. Nothing here calls MPI: a streamed partition is computed on rank 0
+// and broadcast, and the graph loaded, once the layer is taken.
+struct LayerInput {
+    string gtype;
+    LayerFiles files;
+    bool present = false;       // text or binary files exist
+    bool streamed = false;
+    vector<int> my_parts;
+    CSRGraph graph;
+    vector<int> mapping;
+    vector<int> node_to_partition;
+    MetisLineIndex line_index;  // text input, dynamic schedule only
+    int load_ok = 1;            // as returned by loadRankGraph
+    string partition_report;    // rank 0's partitioner output
+    double load_seconds = 0.0;
+};
+
+// OpenMP team of the loader thread, kept small so parsing the next layer
+// takes few cores from the scoring team
+const int LOADER_THREADS = 2;
+
+// With loader_threads > 0 (the pipelined loader thread), the parsers and the
+// partitioner run with that many OpenMP threads; the setting is per thread,
+// so the scoring team keeps its size. Timed with steady_clock, not MPI_Wtime,
+// as nothing here may call MPI.
+LayerInput prepareLayer(const string& gtype, int rank, int size, int num_parts,
+                        bool dynamic_schedule, Partitioner partitioner, int loader_threads) {
+    if (loader_threads > 0) omp_set_num_threads(loader_threads);
+    auto start = chrono::steady_clock::now();
+    LayerInput in;
+    in.gtype = gtype;
+    string base = "higgs-" + gtype + "_network";
+    LayerFiles& files = in.files;
+    files.graph = "graphs/" + base + ".graph";
+    files.part = "gparts/" + base + ".graph.part." + to_string(num_parts);
+    files.map = "gparts/" + base + ".graph.mapping.txt";
+    // The binary container holds the METIS partition, so a streamed one
+    // always reads the text
+    in.streamed = partitioner != Partitioner::Metis;
+    files.bin = in.streamed ? "" : binaryGraphPath(files.graph, num_parts);
+    files.use_mapping = (gtype != "social");
+    files.have_text = filesystem::exists(files.graph) && (in.streamed || filesystem::exists(files.part)) &&
+                      (!files.use_mapping || filesystem::exists(files.map));
+    in.present = files.have_text || filesystem::exists(files.bin);
+    if (!in.present) return in;
+
+    // Static: this rank's partitions are loaded up front. Dynamic: only the
+    // partition vector, the mapping and, for text input, the line index are
+    // needed before the queue; each job then parses its own and its ghost rows.
+    if (!dynamic_schedule) {
+        for (int p = rank; p < num_parts; p += size) in.my_parts.push_back(p);
+    }
+    MetisLineIndex* line_index = dynamic_schedule ? &in.line_index : nullptr;
+    if (!in.streamed) {
+        in.load_ok = loadRankGraph(files, in.my_parts, num_parts, false, in.graph,
+                                   &in.mapping, in.node_to_partition, line_index);
+    } else if (rank == 0 && files.have_text) {
+        PhaseTimer timer(Phase::Partition);
+        ostringstream report;
+        in.node_to_partition = partitionLayer(gtype, files.graph, files.part, files.use_mapping,
+                                              num_parts, partitioner, report);
+        in.partition_report = report.str();
+    }
+    in.load_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return in;
+}
+
+// A scored layer's results on their way to rank 0. The collectives are
+// posted when the layer is scored and completed after the next one is, so
+// no rank waits while rank 0 merges and prints. Buffers stay in place until
+// finishLayer.
+struct PendingLayer {
+    bool active = false;
+    string gtype;
+    bool dynamic = false;
+    string partition_report;
+    vector<pair<int, double>> own_top;   // rank 0's local top-K, METIS IDs
+    vector<double> top, all_top;         // top_k (real ID, score) pairs per rank
+    vector<long long> stats, all_stats;  // 4 per rank
+    vector<double> times, max_times;     // load, wait for the load, scoring
+    vector<MPI_Request> requests;
+};
+
+// Starts the layer's gathers. Each rank sends its own top_k by real ID,
+// padded with ID -1, which hold the global top_k between them.
+void postLayer(PendingLayer& p, const string& gtype, bool dynamic, const string& partition_report,
+               const vector<pair<int, double>>& candidates, const vector<int>& mapping,
+               const vector<long long>& stats, const vector<double>& times, int top_k) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    p.active = true;
+    p.gtype = gtype;
+    p.dynamic = dynamic;
+    p.partition_report = partition_report;
+    if (rank == 0) {
+        unordered_map<int, double> ownCandidates(candidates.begin(), candidates.end());
+        p.own_top = getTopKInfluencers(ownCandidates, top_k);
+    }
+
+    unordered_map<int, double> mine;
+    for (const auto& [localNode, score] : candidates) {
+        int node = realNodeId(mapping, localNode);
+        mine[node] = max(mine[node], score);
+    }
+    vector<pair<int, double>> best = getTopKInfluencers(mine, top_k);
+    p.top.assign(2 * static_cast<size_t>(top_k), -1.0);
+    for (size_t i = 0; i < best.size(); ++i) {
+        p.top[2 * i] = static_cast<double>(best[i].first);
+        p.top[2 * i + 1] = best[i].second;
+    }
+    p.stats = stats;
+    p.times = times;
+    p.all_top.resize(rank == 0 ? p.top.size() * size : 0);
+    p.all_stats.resize(rank == 0 ? 4 * size : 0);
+    p.max_times.resize(rank == 0 ? 3 : 0);
+
+    p.requests.assign(3, MPI_REQUEST_NULL);
+    MPI_Igather(p.top.data(), 2 * top_k, MPI_DOUBLE, p.all_top.data(), 2 * top_k, MPI_DOUBLE,
+                0, MPI_COMM_WORLD, &p.requests[0]);
+    MPI_Igather(p.stats.data(), 4, MPI_LONG_LONG, p.all_stats.data(), 4, MPI_LONG_LONG,
+                0, MPI_COMM_WORLD, &p.requests[1]);
+    MPI_Ireduce(p.times.data(), p.max_times.data(), 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD, &p.requests[2]);
+}
+
+// Completes a posted layer, if any, and prints its report on rank 0. Time
+// spent waiting is added to `wait_seconds`.
+void finishLayer(PendingLayer& p, int top_k, double& wait_seconds) {
+    if (!p.active) return;
+    p.active = false;
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int status;
+    {
+        PhaseTimer timer(Phase::MpiGather);
+        double start = MPI_Wtime();
+        status = MPI_Waitall(static_cast<int>(p.requests.size()), p.requests.data(), MPI_STATUSES_IGNORE);
+        wait_seconds += MPI_Wtime() - start;
+    }
+    if (status != MPI_SUCCESS) {
+        cerr << "MPI_Igather failed!" << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (rank != 0) return;
+
+    PhaseTimer timer(Phase::TopK);
+    const string& gtype = p.gtype;
+    cout << p.partition_report;
+    if (!p.dynamic) {
+        cout << "\n[Rank 0] Halo volume for Graph: " << gtype << endl;
+        for (int r = 0; r < size; ++r) {
+            cout << "Rank " << r << " -> ghosts: " << p.all_stats[4 * r]
+                 << ", peers: " << p.all_stats[4 * r + 1]
+                 << ", sent: " << p.all_stats[4 * r + 2] * sizeof(int) << " B"
+                 << ", received: " << p.all_stats[4 * r + 3] * sizeof(int) << " B" << endl;
+        }
+    } else {
+        cout << "\n[Rank 0] Work distribution for Graph: " << gtype << endl;
+        for (int r = 0; r < size; ++r) {
+            cout << "Rank " << r << " -> partitions: " << p.all_stats[4 * r]
+                 << ", vertices: " << p.all_stats[4 * r + 1]
+                 << ", busy: " << p.all_stats[4 * r + 2] / 1e6 << " s" << endl;
+        }
+    }
+
+    cout << "\n[Rank 0] Local Top-" << top_k << " Influencers for Graph: " << gtype << endl;
+    for (const auto& [node, score] : p.own_top) {
+        cout << "Node " << node << " -> Score: " << score << endl;
+    }
+
+    unordered_map<int, double> merged;
+    for (size_t i = 0; i + 1 < p.all_top.size(); i += 2) {
+        int node = static_cast<int>(p.all_top[i]);
+        if (node < 0) continue;
+        merged[node] = max(merged[node], p.all_top[i + 1]);
+    }
+    cout << "\n[Rank 0] Global Top-" << top_k << " Influencers for Graph: " << gtype << endl;
+    for (const auto& [node, score] : getTopKInfluencers(merged, top_k)) {
+        cout << "Node " << node << " -> Score: " << score << endl;
+    }
+    cout << "\n[Rank 0] Timing for Graph: " << gtype << " -> load " << p.max_times[0]
+         << " s (waited " << p.max_times[1] << " s), scoring " << p.max_times[2]
+         << " s (max over ranks)" << endl;
+}
+
+int main(int argc, char** argv) {
+    // Only the main thread calls MPI; the layer loader thread does not
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    bool funneled = provided >= MPI_THREAD_FUNNELED;
 
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-        // Load mapping file to get real-world node IDs
-        unordered_map<int, int> localToRealWorldMapping;
-        if (use_mapping) {
-            ifstream mapFile(map_path);
-            if (!mapFile.is_open()) {
+    // --parts N picks the .part.N file (any N, any -np); --schedule static
+    // assigns partition p to rank p % size and exchanges halos over MPI,
+    // --schedule dynamic (default) lets ranks pull partitions from a shared
+    // counter, largest first, and read halos from storage. --omp-schedule
+    // picks the thread schedule of the scoring kernel inside each rank and
+    // --engine edge intersects each edge once instead of from both ends and
+    // --engine minhash estimates Jaccard from --sketch-size sized sketches.
+    // --profile FILE names the JSON report of phases, counters and thread
+    // busy time over all ranks, written by rank 0 (profile.json).
+    // --partitioner ldg|fennel has rank 0 split each layer into --parts
+    // parts at load time instead of reading the gpmetis file (metis).
+    // --top-k K and --weights m,rt,rp,s set the list length and the layer
+    // weights of the combined score. --no-pipeline loads and reports each
+    // layer in turn instead of overlapping them with the scoring.
+    // --reorder degree|rcm relabels each partition's vertices, halo included,
+    // before it is scored (none keeps METIS order).
+    int num_parts = NUM_PARTS;
+    bool dynamic_schedule = true;
+    ScoreOptions options;
+    Partitioner partitioner = Partitioner::Metis;
+    string profile_path = "profile.json";
+    int top_k = K;
+    vector<double> weights = LAYER_WEIGHTS;
+    bool pipeline = true;
+    VertexOrder vertex_order = VertexOrder::None;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--parts" && i + 1 < argc) {
+            num_parts = atoi(argv[++i]);
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            dynamic_schedule = string(argv[++i]) != "static";
+        } else if (arg == "--omp-schedule" && i + 1 < argc) {
+            options.schedule = parseKernelSchedule(argv[++i]);
+        } else if (arg == "--engine" && i + 1 < argc) {
+            options.engine = parseScoreEngine(argv[++i]);
+        } else if (arg == "--sketch-size" && i + 1 < argc) {
+            options.sketch_size = atoi(argv[++i]);
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--partitioner" && i + 1 < argc) {
+            partitioner = parsePartitioner(argv[++i]);
+        } else if (arg == "--top-k" && i + 1 < argc) {
+            top_k = atoi(argv[++i]);
+        } else if (arg == "--weights" && i + 1 < argc) {
+            if (!parseLayerWeights(argv[++i], weights)) {
                 if (rank == 0) {
-                    cerr << "Error opening mapping file: " << map_path << endl;
+                    cerr << "--weights needs " << graph_types.size() << " comma-separated values" << endl;
                 }
                 MPI_Finalize();
                 return 1;
             }
-
-            int local_id, real_id;
-            while (mapFile >> real_id >> local_id) {
-                localToRealWorldMapping[local_id] = real_id;
+        } else if (arg == "--no-pipeline") {
+            pipeline = false;
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertex_order = parseVertexOrder(argv[++i]);
+        } else {
+            if (rank == 0) {
+                cerr << "Usage: " << argv[0] << " [--parts N] [--schedule static|dynamic]"
+                     << " [--omp-schedule static|dynamic|degree]"
+                     << " [--engine vertex|edge|minhash] [--sketch-size K] [--profile FILE]"
+                     << " [--partitioner metis|ldg|fennel] [--top-k K] [--weights m,rt,rp,s]"
+                     << " [--no-pipeline] [--reorder none|degree|rcm]" << endl;
             }
-            mapFile.close();
+            MPI_Finalize();
+            return 1;
+        }
+    }
+    if (pipeline && !funneled) {
+        if (rank == 0) {
+            cerr << "Warning: MPI does not support MPI_THREAD_FUNNELED, running with --no-pipeline" << endl;
+        }
+        pipeline = false;
+    }
+    if (num_parts < 1) {
+        if (rank == 0) {
+            cerr << "--parts must be at least 1" << endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (top_k < 1) {
+        if (rank == 0) {
+            cerr << "--top-k must be at least 1" << endl;
         }
+        MPI_Finalize();
+        return 1;
+    }
+    if (options.sketch_size < 1) {
+        if (rank == 0) {
+            cerr << "--sketch-size must be at least 1" << endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
 
-        vector<unordered_map<int, vector<Edge>>> subgraphs(NUM_PARTS);
-        loadGraph(graph_path, part_path, map_path, subgraphs, use_mapping);
-        const auto& local_subgraph = subgraphs[rank];
+    // Every rank's share of the combined score, keyed by real-world ID
+    unordered_map<int, double> partialScores;
+    unordered_map<string, int> gtypeIndex = {
+        {"mention", 0}, {"retweet", 1}, {"reply", 2}, {"social", 3}
+    };
 
-        unordered_map<int, double> scores = computeInfluenceScores(local_subgraph);
+    // Layer i+1 is read on a loader thread while layer i is scored, and the
+    // results of layer i travel to rank 0 while layer i+1 is scored. With
+    // --no-pipeline both happen in place, one layer after the other.
+    launch policy = pipeline ? launch::async : launch::deferred;
+    int loader_threads = pipeline ? min(LOADER_THREADS, omp_get_max_threads()) : 0;
+    auto prefetch = [&](size_t l) {
+        return async(policy, prepareLayer, graph_types[l], rank, size, num_parts, dynamic_schedule,
+                     partitioner, loader_threads);
+    };
+    future<LayerInput> next = prefetch(0);
+    PendingLayer pending;
+    double load_total = 0.0, load_hidden = 0.0, gather_wait = 0.0;
+    double loop_start = MPI_Wtime();
 
-        // int k = 10;
-        vector<pair<int, double>> localTopK = getTopKInfluencers(scores, K);
+    for (size_t l = 0; l < graph_types.size(); ++l) {
+        double wait_start = MPI_Wtime();
+        LayerInput in = next.get();
+        double load_wait = MPI_Wtime() - wait_start;
+        if (l + 1 < graph_types.size()) next = prefetch(l + 1);
+        const string& gtype = in.gtype;
 
-        if (rank == 0) {
-            cout << "\n[Rank " << rank << "] Local Top-" << K << " Influencers for Graph: " << gtype << endl;
-            for (const auto& [node, score] : localTopK) {
-                cout << "Node " << node << " -> Score: " << score << endl;
+        if (!in.present) {
+            finishLayer(pending, top_k, gather_wait);
+            if (rank == 0) {
+                cerr << "Missing file(s) for graph type: " << gtype << endl;
             }
+            continue;
         }
 
-        vector<double> packedLocal(2 * K);
-        for (int i = 0; i < K; ++i) {
-            packedLocal[2 * i] = static_cast<double>(localTopK[i].first);
-            packedLocal[2 * i + 1] = localTopK[i].second;
+        // A streamed partition reaches the other ranks before they can load
+        if (in.streamed) {
+            double load_start = MPI_Wtime();
+            if (in.files.have_text) {
+                PhaseTimer timer(Phase::Partition);
+                int count = static_cast<int>(in.node_to_partition.size());
+                MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+                if (count == 0) {   // rank 0 could not read the graph
+                    finishLayer(pending, top_k, gather_wait);
+                    continue;
+                }
+                in.node_to_partition.resize(count);
+                MPI_Bcast(in.node_to_partition.data(), count, MPI_INT, 0, MPI_COMM_WORLD);
+            }
+            in.load_ok = loadRankGraph(in.files, in.my_parts, num_parts, false, in.graph,
+                                       &in.mapping, in.node_to_partition,
+                                       dynamic_schedule ? &in.line_index : nullptr);
+            double seconds = MPI_Wtime() - load_start;
+            in.load_seconds += seconds;
+            load_wait += seconds;
         }
+        load_total += in.load_seconds;
+        load_hidden += max(0.0, in.load_seconds - load_wait);
+        double layer_weight = weights[gtypeIndex[gtype]];
 
-        vector<double> allPacked;
-        if (rank == 0) {
-            allPacked.resize(2 * K * size);
+        // A failed load on any rank must not leave the others waiting in a collective
+        int all_ok = 0;
+        MPI_Allreduce(&in.load_ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        if (all_ok < 0) {
+            finishLayer(pending, top_k, gather_wait);
+            if (rank == 0) {
+                cerr << "Missing or unreadable file(s) for graph type: " << gtype << endl;
+            }
+            continue;
         }
-
-        int gather_status = MPI_Gather(packedLocal.data(), 2 * K, MPI_DOUBLE,
-                                       allPacked.data(), 2 * K, MPI_DOUBLE,
-                                       0, MPI_COMM_WORLD);
-
-        if (gather_status != MPI_SUCCESS) {
-            cerr << "MPI_Gather failed!" << endl;
+        if (all_ok == 0) {
+            finishLayer(pending, top_k, gather_wait);
+            if (rank == 0) {
+                cerr << "Error opening mapping file: " << in.files.map << endl;
+            }
             MPI_Finalize();
             return 1;
         }
 
-        if (rank == 0) {
-            vector<pair<int, double>> allCandidates;
-            for (int i = 0; i < size * K; ++i) {
-                int localNode = static_cast<int>(allPacked[2 * i]);
-                double score = allPacked[2 * i + 1];
-                int realNode = localToRealWorldMapping.count(localNode) ? localToRealWorldMapping[localNode] : localNode;
-                allCandidates.emplace_back(realNode, score);
-            }
+        // Local top-K of every partition this rank scored, as (METIS ID, score)
+        vector<pair<int, double>> candidates;
+        // Halo volume (static) or work distribution (dynamic) of this rank
+        vector<long long> layer_stats(4, 0);
+        double score_start = MPI_Wtime();
 
-            unordered_map<int, double> merged;
-            for (const auto& [node, score] : allCandidates) {
-                merged[node] = max(merged[node], score);
+        if (!dynamic_schedule) {
+            // Pull the rows of remote endpoints of cut edges so they are scored too
+            vector<int> part_owner(num_parts);
+            for (int p = 0; p < num_parts; ++p) part_owner[p] = p % size;
+            HaloStats halo;
+            {
+                PhaseTimer timer(Phase::NeighborBuild);
+                halo = exchangeHalo(in.graph, in.node_to_partition, part_owner, MPI_COMM_WORLD);
+            }
+            layer_stats = {halo.ghosts, halo.peers, halo.sent_ints, halo.recv_ints};
+            {
+                PhaseTimer timer(Phase::NeighborBuild);
+                reorderGraph(in.graph, vertex_order);
             }
 
-            auto globalTopK = getTopKInfluencers(merged, K);
+            scoreGraph(in.graph, options, in.mapping, layer_weight, top_k,
+                       candidates, partialScores);
+        } else {
+            // Hand out the largest partitions first so small ones fill the tail
+            vector<long long> part_size(num_parts, 0);
+            for (int p : in.node_to_partition) part_size[p]++;
+            vector<int> order(num_parts);
+            for (int p = 0; p < num_parts; ++p) order[p] = p;
+            stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                return part_size[a] > part_size[b];
+            });
+
+            // Shared work counter lives on rank 0
+            int counter = 0;
+            MPI_Win win;
+            MPI_Win_create(&counter, rank == 0 ? sizeof(int) : 0, sizeof(int),
+                           MPI_INFO_NULL, MPI_COMM_WORLD, &win);
 
-            cout << "\n[Rank 0] Global Top-" << K << " Influencers for Graph: " << gtype << endl;
-            for (const auto& [node, score] : globalTopK) {
-                cout << "Node " << node << " -> Score: " << score << endl;
+            int one = 1;
+            long long work[3] = {0, 0, 0};   // partitions, vertices, busy microseconds
+            int job_ok = 1;
+            while (true) {
+                int next = 0;
+                MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+                MPI_Fetch_and_op(&one, &next, MPI_INT, 0, 0, MPI_SUM, win);
+                MPI_Win_unlock(0, win);
+                if (next >= num_parts) break;
+
+                auto job_start = chrono::steady_clock::now();
+                CSRGraph part_graph;
+                int status = loadRankGraph(in.files, {order[next]}, num_parts, true, part_graph,
+                                           nullptr, in.node_to_partition, &in.line_index);
+                if (status != 1) {
+                    job_ok = status;
+                    continue;
+                }
+                {
+                    PhaseTimer timer(Phase::NeighborBuild);
+                    reorderGraph(part_graph, vertex_order);
+                }
+                scoreGraph(part_graph, options, in.mapping, layer_weight, top_k,
+                           candidates, partialScores);
+                work[0]++;
+                work[1] += part_graph.num_local;
+                work[2] += chrono::duration_cast<chrono::microseconds>(
+                    chrono::steady_clock::now() - job_start).count();
             }
+            MPI_Win_free(&win);
 
-            // Update global allNodeScores map
-            int idx = gtypeIndex[gtype];
-            for (const auto& [node, score] : globalTopK) {
-                if (!allNodeScores.count(node)) {
-                    allNodeScores[node] = vector<double>(4, 0.0);
+            MPI_Allreduce(MPI_IN_PLACE, &job_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+            if (job_ok != 1) {
+                finishLayer(pending, top_k, gather_wait);
+                if (rank == 0) {
+                    cerr << "Failed to load a partition for graph type: " << gtype << endl;
                 }
-                allNodeScores[node][idx] = score;
+                MPI_Finalize();
+                return 1;
             }
+
+            layer_stats = {work[0], work[1], work[2], 0};
         }
+        double score_seconds = MPI_Wtime() - score_start;
+
+        // Rank 0 prints the previous layer while this one's results are sent
+        finishLayer(pending, top_k, gather_wait);
+        postLayer(pending, gtype, dynamic_schedule, in.partition_report, candidates, in.mapping,
+                  layer_stats, {in.load_seconds, load_wait, score_seconds}, top_k);
+        if (!pipeline) finishLayer(pending, top_k, gather_wait);
     }
+    finishLayer(pending, top_k, gather_wait);
 
-    // After all graphs processed, compute final weighted score
+    // Time the overlap took off the layer loop: loads that ran behind the
+    // previous layer's scoring, and results merged behind the next one's
+    double pipe[4] = {MPI_Wtime() - loop_start, load_total, load_hidden, gather_wait};
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : pipe, pipe, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
     if (rank == 0) {
-        vector<double> weights = {0.3, 0.5, 0.4, 0.01}; // mention, retweet, reply, social
-        vector<pair<int, double>> finalScores;
+        cout << "\n[Rank 0] Pipeline (" << (pipeline ? "overlapped, loader team of " + to_string(loader_threads) +
+                                                  " OpenMP threads" : "sequential")
+             << "): layers took "
+             << pipe[0] << " s, loading " << pipe[1] << " s of which " << pipe[2]
+             << " s ran behind scoring, " << pipe[3] << " s waiting for results (max over ranks)" << endl;
+    }
 
-        for (const auto& [node, vec] : allNodeScores) {
-            double overall = 0.0;
-            for (int i = 0; i < 4; ++i) {
-                overall += weights[i] * vec[i];
-            }
-            finalScores.emplace_back(node, overall);
-        }
+    // Text parsed by all ranks; ranks ingest concurrently, so throughput is
+    // total bytes over the slowest rank's parse time
+    const IngestStats& ingest = ingestStats();
+    double ingest_bytes = static_cast<double>(ingest.bytes), ingest_seconds = ingest.seconds;
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &ingest_bytes, &ingest_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &ingest_seconds, &ingest_seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0 && ingest_bytes > 0) {
+        cout << "\n[Rank 0] Text ingest: " << ingest_bytes / 1e6 << " MB in " << ingest_seconds
+             << " s (" << (ingest_seconds > 0 ? ingest_bytes / 1e6 / ingest_seconds : 0.0)
+             << " MB/s)" << endl;
+    }
 
-        sort(finalScores.begin(), finalScores.end(), [](const auto& a, const auto& b) {
-            return a.second > b.second;
-        });
+    // Exact top-K of the weighted score over every user, not just the
+    // per-layer top-K lists
+    TopKStats topk_stats;
+    vector<pair<int, double>> finalScores;
+    {
+        PhaseTimer timer(Phase::MpiGather);
+        finalScores = distributedTopK(partialScores, top_k, MPI_COMM_WORLD, topk_stats);
+    }
+
+    if (rank == 0) {
+        if (topk_stats.full_gather) {
+            cout << "\n[Rank 0] Combined top-" << top_k << " exchange -> negative weights, gathered all "
+                 << topk_stats.first_round << " pairs" << endl;
+        } else {
+            cout << "\n[Rank 0] Combined top-" << top_k << " exchange -> round 1: " << topk_stats.first_round
+                 << " pairs, round 2: " << topk_stats.second_round
+                 << " pairs, verified: " << topk_stats.verified << " candidates" << endl;
+        }
 
-        // int final_k = 10;
-        cout << "\n========== FINAL GLOBAL TOP-" << K << " INFLUENCERS ==========\n";
-        for (int i = 0; i < min(K, (int)finalScores.size()); ++i) {
-            int node = finalScores[i].first;
-            double score = finalScores[i].second;
-            const auto& vec = allNodeScores[node];
+        cout << "\n========== FINAL GLOBAL TOP-" << top_k << " INFLUENCERS ==========\n";
+        for (const auto& [node, score] : finalScores) {
             cout << "Node " << node << " -> Overall Score: " << score << endl;
-                 //<< " [Mention: " << vec[0] << ", Retweet: " << vec[1]
-                 //<< ", Reply: " << vec[2] << ", Social: " << vec[3] << "]\n";
+        }
+    }
+
+    // One report for the run: every rank's phases, counters and thread busy
+    // time, summarized on rank 0
+    if (PROFILE_ENABLED) {
+        vector<double> packed = profile().pack();
+        int count = static_cast<int>(packed.size());
+        vector<int> counts(rank == 0 ? size : 0), displs(rank == 0 ? size + 1 : 0, 0);
+        MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+        vector<double> all;
+        if (rank == 0) {
+            for (int r = 0; r < size; ++r) displs[r + 1] = displs[r] + counts[r];
+            all.resize(displs[size]);
+        }
+        MPI_Gatherv(packed.data(), count, MPI_DOUBLE, all.data(), counts.data(), displs.data(),
+                    MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            vector<vector<double>> ranks(size);
+            for (int r = 0; r < size; ++r) {
+                ranks[r].assign(all.begin() + displs[r], all.begin() + displs[r + 1]);
+            }
+            if (writeProfileJson(profile_path, "run_mpi", ranks)) {
+                cout << "\n[Rank 0] Profile written to " << profile_path << endl;
+            }
         }
     }
 
@@ -0,0 +1,157 @@
+#ifndef SCORE_CACHE_H
+#define SCORE_CACHE_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+
+#include "load_graph.h"
+#include "binary_graph.h"
+#include "Influence.h"
+#include "compressed_graph.h"
+#include "partitioner.h"
+#include "reorder.h"
+
+using namespace std;
+
+// Per-layer influence scores kept between runs, so a rerun that only changes
+// the layer weights or K skips loading and scoring. A cache file holds the
+// merged score of every vertex of one layer, keyed by real-world ID:
+//
+//   ScoreCacheHeader
+//   int32 real_ids[count]      ascending
+//   double scores[count]
+//
+// The key is a hash over the contents of the input files (graph, partition,
+// mapping) and a description of the scoring parameters. It is part of the
+// file name and is checked again in the header, so a changed input or
+// option misses and the layer is rescored.
+
+const char SCORE_CACHE_MAGIC[8] = {'H', 'G', 'S', 'C', 'O', 'R', 'E', 'S'};
+const uint32_t SCORE_CACHE_VERSION = 1;
+
+// Files are hashed in chunks of this size in parallel, then over the chunk
+// hashes, so the hash does not depend on the thread count.
+const size_t CONTENT_HASH_CHUNK = 1 << 20;
+
+struct ScoreCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    int64_t count;
+};
+
+// Hash of a file's size and bytes; 0 if it cannot be read.
+uint64_t fileContentHash(const string& path) {
+    MappedFile file(path);
+    if (!file.opened) return 0;
+    size_t chunks = (file.size + CONTENT_HASH_CHUNK - 1) / CONTENT_HASH_CHUNK;
+    vector<uint64_t> hashes(chunks);
+    #pragma omp parallel for schedule(dynamic, 4)
+    for (size_t c = 0; c < chunks; ++c) {
+        size_t begin = c * CONTENT_HASH_CHUNK;
+        hashes[c] = fnv1a(file.data + begin, min(CONTENT_HASH_CHUNK, file.size - begin));
+    }
+    uint64_t size = file.size;
+    return fnv1a(hashes.data(), hashes.size() * sizeof(uint64_t), fnv1a(&size, sizeof(size)));
+}
+
+// Key of a layer's scores. Empty paths stand for inputs the layer does not
+// have (no mapping, partition computed at load time).
+uint64_t scoreCacheKey(const vector<string>& inputs, const string& params) {
+    uint64_t key = fnv1a(params.data(), params.size());
+    for (const string& path : inputs) {
+        uint64_t h = path.empty() ? 0 : fileContentHash(path);
+        key = fnv1a(&h, sizeof(h), key);
+    }
+    return key;
+}
+
+// Everything besides the input files that changes the scores. The vertex
+// order is included because it changes the summation order of each score.
+string scoreCacheParams(const ScoreOptions& options, AdjacencyLayout layout, Partitioner partitioner,
+                        int num_parts, VertexOrder order = VertexOrder::None) {
+    return "engine=" + to_string(static_cast<int>(options.engine)) +
+           " schedule=" + to_string(static_cast<int>(options.schedule)) +
+           " layout=" + to_string(static_cast<int>(layout)) +
+           " partitioner=" + partitionerName(partitioner) +
+           " parts=" + to_string(num_parts) +
+           (order == VertexOrder::None ? "" : string(" order=") + vertexOrderName(order));
+}
+
+string scoreCachePath(const string& dir, const string& base, uint64_t key) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return dir + "/" + base + "." + hex + ".scores";
+}
+
+bool loadScoreCache(const string& path, uint64_t key, unordered_map<int, double>& scores) {
+    MappedFile file(path);
+    if (!file.data || file.size < sizeof(ScoreCacheHeader)) return false;
+    ScoreCacheHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, SCORE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SCORE_CACHE_VERSION || header.key != key || header.count < 0 ||
+        file.size != sizeof(header) + header.count * (sizeof(int32_t) + sizeof(double))) {
+        cerr << "Warning: Ignoring invalid score cache " << path << endl;
+        return false;
+    }
+    const char* ids = file.data + sizeof(header);
+    const char* values = ids + header.count * sizeof(int32_t);
+    scores.clear();
+    scores.reserve(header.count);
+    for (int64_t i = 0; i < header.count; ++i) {
+        int32_t id;
+        double score;
+        memcpy(&id, ids + i * sizeof(int32_t), sizeof(id));
+        memcpy(&score, values + i * sizeof(double), sizeof(score));
+        scores.emplace(id, score);
+    }
+    return true;
+}
+
+// Written to a temporary file and renamed, so readers never see a partial one.
+bool writeScoreCache(const string& path, uint64_t key, const unordered_map<int, double>& scores) {
+    vector<pair<int, double>> sorted(scores.begin(), scores.end());
+    sort(sorted.begin(), sorted.end());
+    vector<int32_t> ids(sorted.size());
+    vector<double> values(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        ids[i] = sorted[i].first;
+        values[i] = sorted[i].second;
+    }
+
+    ScoreCacheHeader header = {};
+    memcpy(header.magic, SCORE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = SCORE_CACHE_VERSION;
+    header.key = key;
+    header.count = static_cast<int64_t>(sorted.size());
+
+    error_code ec;
+    filesystem::create_directories(filesystem::path(path).parent_path(), ec);
+    string tmp_path = path + ".tmp";
+    {
+        ofstream out(tmp_path, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(int32_t));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+        if (!out) {
+            cerr << "Warning: Cannot write score cache " << tmp_path << endl;
+            return false;
+        }
+    }
+    filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        cerr << "Warning: Cannot write score cache " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
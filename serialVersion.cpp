@@ -7,88 +7,515 @@
 #include <algorithm>
 #include <filesystem>
 #include <chrono>
+#include <cstdlib>
 #include "load_graph.h"
+#include "binary_graph.h"
 #include "Influence.h"
+#include "multiplex.h"
 #include "Top-k.h"
+#include "compressed_graph.h"
+#include "partitioner.h"
+#include "score_cache.h"
+#include "reorder.h"
+#include "numa.h"
+#include "out_of_core.h"
+#include "profile.h"
 
 using namespace std;
 
 const int K = 10;
 
-int main() {
+int main(int argc, char** argv) {
+    // --parts N picks the .part.N file written by gpmetis; --omp-schedule
+    // chooses how the scoring kernel spreads vertices over threads and
+    // --engine edge intersects each edge once instead of from both ends.
+    // --engine minhash estimates Jaccard from --sketch-size sized sketches
+    // and reports its top-K overlap with the exact scores. --multiplex loads
+    // all layers onto one vertex index and scores them in a single sweep.
+    // --profile FILE names the JSON phase/counter report (profile.json).
+    // --layout compressed keeps the partitions varint coded while scoring.
+    // --partitioner ldg|fennel splits each layer into --parts parts at load
+    // time instead of reading the gpmetis file (metis, the default).
+    // --top-k K and --weights m,rt,rp,s set the list length and the layer
+    // weights of the combined score. Layer scores are cached in --cache-dir
+    // (cache) and reused while the inputs and options are unchanged;
+    // --no-cache always rescores. --reorder degree|rcm relabels each
+    // partition's vertices before scoring so neighbor rows are read closer
+    // together (none, the default, keeps METIS order). --numa first-touch
+    // pins threads to NUMA nodes and copies each partition so its rows are
+    // placed on the node that scores them under the static schedule, which it
+    // selects unless --omp-schedule says otherwise; --numa replicate gives every node
+    // its own copy (off, the default, does neither). --out-of-core MIB scores
+    // each whole layer from blocks on disk (--block-dir, blocks) within a
+    // memory budget of MIB mebibytes for the adjacency.
+    int num_parts = NUM_PARTS;
+    int top_k = K;
+    vector<double> weights = LAYER_WEIGHTS; // mention, retweet, reply, social
+    string cache_dir = "cache";
+    bool use_cache = true;
+    ScoreOptions options;
+    bool schedule_given = false;
+    AdjacencyLayout layout = AdjacencyLayout::Plain;
+    bool multiplex = false;
+    Partitioner partitioner = Partitioner::Metis;
+    VertexOrder vertex_order = VertexOrder::None;
+    NumaMode numa = NumaMode::Off;
+    uint64_t memory_budget = 0;     // bytes; 0 keeps layers in memory
+    string block_dir = "blocks";
+    string profile_path = "profile.json";
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--parts" && i + 1 < argc) {
+            num_parts = atoi(argv[++i]);
+        } else if (arg == "--omp-schedule" && i + 1 < argc) {
+            options.schedule = parseKernelSchedule(argv[++i]);
+            schedule_given = true;
+        } else if (arg == "--engine" && i + 1 < argc) {
+            options.engine = parseScoreEngine(argv[++i]);
+        } else if (arg == "--sketch-size" && i + 1 < argc) {
+            options.sketch_size = atoi(argv[++i]);
+        } else if (arg == "--multiplex") {
+            multiplex = true;
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--layout" && i + 1 < argc) {
+            layout = parseAdjacencyLayout(argv[++i]);
+        } else if (arg == "--partitioner" && i + 1 < argc) {
+            partitioner = parsePartitioner(argv[++i]);
+        } else if (arg == "--top-k" && i + 1 < argc) {
+            top_k = atoi(argv[++i]);
+        } else if (arg == "--weights" && i + 1 < argc) {
+            if (!parseLayerWeights(argv[++i], weights)) {
+                cerr << "--weights needs " << graph_types.size() << " comma-separated values" << endl;
+                return 1;
+            }
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (arg == "--no-cache") {
+            use_cache = false;
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertex_order = parseVertexOrder(argv[++i]);
+        } else if (arg == "--numa" && i + 1 < argc) {
+            numa = parseNumaMode(argv[++i]);
+        } else if (arg == "--out-of-core" && i + 1 < argc) {
+            memory_budget = static_cast<uint64_t>(atof(argv[++i]) * 1024 * 1024);
+            if (memory_budget == 0) {
+                cerr << "--out-of-core needs a budget in MiB" << endl;
+                return 1;
+            }
+        } else if (arg == "--block-dir" && i + 1 < argc) {
+            block_dir = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [--parts N] [--omp-schedule static|dynamic|degree]"
+                 << " [--engine vertex|edge|minhash] [--sketch-size K] [--multiplex]"
+                 << " [--profile FILE] [--layout plain|compressed]"
+                 << " [--partitioner metis|ldg|fennel] [--top-k K] [--weights m,rt,rp,s]"
+                 << " [--cache-dir DIR] [--no-cache] [--reorder none|degree|rcm]"
+                 << " [--numa off|first-touch|replicate] [--out-of-core MIB] [--block-dir DIR]" << endl;
+            return 1;
+        }
+    }
+    if (num_parts < 1) {
+        cerr << "--parts must be at least 1" << endl;
+        return 1;
+    }
+    if (options.sketch_size < 1) {
+        cerr << "--sketch-size must be at least 1" << endl;
+        return 1;
+    }
+    if (top_k < 1) {
+        cerr << "--top-k must be at least 1" << endl;
+        return 1;
+    }
+    bool compressed = layout == AdjacencyLayout::Compressed;
+    if (compressed && (options.engine != ScoreEngine::Vertex || multiplex)) {
+        cerr << "--layout compressed works with the vertex engine without --multiplex" << endl;
+        return 1;
+    }
+    if (multiplex && vertex_order != VertexOrder::None) {
+        cerr << "--reorder works without --multiplex" << endl;
+        return 1;
+    }
+    if (numa != NumaMode::Off && (compressed || multiplex)) {
+        cerr << "--numa works with --layout plain without --multiplex" << endl;
+        return 1;
+    }
+    if (numa == NumaMode::Replicate && options.engine != ScoreEngine::Vertex) {
+        cerr << "--numa replicate works with the vertex engine" << endl;
+        return 1;
+    }
+    // First-touch places the rows of each static block on the node of the
+    // thread that scores them; other schedules do not follow that layout
+    if (numa == NumaMode::FirstTouch && !schedule_given) {
+        options.schedule = KernelSchedule::Static;
+    } else if (numa == NumaMode::FirstTouch && options.schedule != KernelSchedule::Static) {
+        cerr << "Warning: --numa first-touch places pages for --omp-schedule static;"
+             << " other schedules read most rows from remote nodes" << endl;
+    }
+    bool out_of_core = memory_budget > 0;
+    if (out_of_core && (compressed || multiplex || options.engine == ScoreEngine::MinHash ||
+                        vertex_order != VertexOrder::None || numa != NumaMode::Off)) {
+        cerr << "--out-of-core computes exact scores on the plain layout, without --multiplex,"
+             << " --reorder or --numa" << endl;
+        return 1;
+    }
+    bool approximate = options.engine == ScoreEngine::MinHash;
+    ScoreOptions exact_options = options;
+    exact_options.engine = ScoreEngine::Vertex;
+
+    // --multiplex combines every user's layer scores and minhash also needs
+    // the exact ones, so both always rescore. Out-of-core runs keep only the
+    // top-K, so they have no full score table to cache
+    use_cache = use_cache && !multiplex && !approximate && !out_of_core;
+    string cache_params = scoreCacheParams(options, layout, partitioner, num_parts, vertex_order);
+
+    // Pin once; OpenMP keeps the same threads for every later region
+    NumaTopology topology;
+    vector<int> thread_node;
+    if (numa != NumaMode::Off) {
+        topology = detectNumaTopology();
+        thread_node = pinThreads(topology);
+        cout << "NUMA (" << numaModeName(numa) << "): " << topology.nodes() << " node(s), "
+             << thread_node.size() << " threads pinned" << endl;
+    }
+
     unordered_map<int, vector<double>> allNodeScores;
     unordered_map<string, int> gtypeIndex = {
         {"mention", 0}, {"retweet", 1}, {"reply", 2}, {"social", 3}
     };
 
+    // Whole-graph layers and their mappings, collected for --multiplex
+    vector<CSRGraph> layerGraphs(graph_types.size());
+    vector<vector<int>> layerMappings(graph_types.size());
+
+    // Prints a layer's top-K and keeps it for the combined score
+    auto reportLayer = [&](const string& gtype, const vector<pair<int, double>>& globalTopK) {
+        cout << "\nGlobal Top-" << top_k << " Influencers for Graph: " << gtype << endl;
+        for (const auto& [node, score] : globalTopK) {
+            cout << "Node " << node << " -> Score: " << score << endl;
+        }
+
+        // Update global allNodeScores map
+        int idx = gtypeIndex[gtype];
+        for (const auto& [node, score] : globalTopK) {
+            if (!allNodeScores.count(node)) {
+                allNodeScores[node] = vector<double>(4, 0.0);
+            }
+            allNodeScores[node][idx] = score;
+        }
+    };
+
     auto start_time = chrono::high_resolution_clock::now();
 
     for (const auto& gtype : graph_types) {
         string base = "higgs-" + gtype + "_network";
         string graph_path = "graphs/" + base + ".graph";
-        string part_path = "gparts/" + base + ".graph.part.8";
+        string part_path = "gparts/" + base + ".graph.part." + to_string(num_parts);
         string map_path = "gparts/" + base + ".graph.mapping.txt";
         bool use_mapping = (gtype != "social");
 
-        if (!filesystem::exists(graph_path) || !filesystem::exists(part_path) ||
-            (use_mapping && !filesystem::exists(map_path))) {
+        // Out of core: whole layer from disk blocks, keeping only the top-K
+        if (out_of_core) {
+            if (!filesystem::exists(graph_path) || (use_mapping && !filesystem::exists(map_path))) {
+                cerr << "Missing file(s) for graph type: " << gtype << endl;
+                continue;
+            }
+            vector<int> mapping;
+            if (use_mapping) {
+                PhaseTimer timer(Phase::MappingLoad);
+                mapping = loadMapping(map_path);
+                if (mapping.empty()) {
+                    cerr << "Error opening mapping file: " << map_path << endl;
+                    return 1;
+                }
+            }
+            BlockStore store;
+            OutOfCoreStats ooc;
+            if (!prepareBlockStore(graph_path, use_mapping, memory_budget, block_dir + "/" + base, store, ooc)) {
+                continue;
+            }
+            HeapTopK best(top_k);
+            if (!scoreOutOfCore(store, [&](int node, double score) {
+                    best.offer(realNodeId(mapping, node), score);
+                }, ooc)) {
+                continue;
+            }
+            const double MIB = 1024.0 * 1024;
+            cout << "\nOut-of-core for Graph: " << gtype << " -> " << store.blocks.size() << " blocks ("
+                 << (ooc.built ? "built in " + to_string(ooc.build_seconds) + " s" : string("reused"))
+                 << "), " << ooc.pairs << " block pairs, read " << ooc.bytes_read / MIB << " MiB in "
+                 << ooc.read_seconds << " s, waited " << ooc.wait_seconds << " s, scoring "
+                 << ooc.score_seconds << " s, peak " << ooc.peak_bytes / MIB << " of "
+                 << memory_budget / MIB << " MiB" << endl;
+            reportLayer(gtype, best.result());
+            continue;
+        }
+
+        // The binary container holds the METIS partition, so a streamed one
+        // always reads the text
+        bool streamed = partitioner != Partitioner::Metis;
+        string bin_path = streamed ? "" : binaryGraphPath(graph_path, num_parts);
+        bool have_text = filesystem::exists(graph_path) && (streamed || filesystem::exists(part_path)) &&
+                         (!use_mapping || filesystem::exists(map_path));
+        if (!have_text && !filesystem::exists(bin_path)) {
             cerr << "Missing file(s) for graph type: " << gtype << endl;
             continue;
         }
 
-        // Load mapping file
-        unordered_map<int, int> localToRealWorldMapping;
-        if (use_mapping) {
-            ifstream mapFile(map_path);
-            if (!mapFile.is_open()) {
-                cerr << "Error opening mapping file: " << map_path << endl;
-                return 1;
+        // Unchanged inputs and options: reuse the layer's scores
+        uint64_t cache_key = 0;
+        string cache_path;
+        if (use_cache) {
+            vector<string> inputs = {graph_path, streamed ? "" : part_path, use_mapping ? map_path : ""};
+            if (!have_text) inputs = {bin_path};
+            cache_key = scoreCacheKey(inputs, cache_params);
+            cache_path = scoreCachePath(cache_dir, base, cache_key);
+            unordered_map<int, double> cached;
+            if (loadScoreCache(cache_path, cache_key, cached)) {
+                cout << "\nScores for Graph: " << gtype << " loaded from " << cache_path << endl;
+                vector<pair<int, double>> cachedTopK;
+                {
+                    PhaseTimer timer(Phase::TopK);
+                    cachedTopK = getTopKInfluencers(cached, top_k);
+                }
+                reportLayer(gtype, cachedTopK);
+                continue;
+            }
+        }
+
+        // Prefer the prebuilt binary container; it carries the mapping as well
+        vector<CSRGraph> subgraphs(num_parts);
+        vector<int> localToRealWorldMapping;
+        vector<int> node_to_partition;
+        bool from_binary = false;
+        if (streamed) {
+            PhaseTimer timer(Phase::Partition);
+            node_to_partition = partitionLayer(gtype, graph_path, part_path, use_mapping, num_parts, partitioner);
+            if (node_to_partition.empty()) continue;
+        } else {
+            PhaseTimer timer(Phase::GraphParse);
+            from_binary = loadBinaryGraph(bin_path, graph_path, part_path, use_mapping ? map_path : "",
+                                          subgraphs, localToRealWorldMapping);
+        }
+        if (!from_binary) {
+            if (!have_text) {
+                cerr << "Missing file(s) for graph type: " << gtype << endl;
+                continue;
+            }
+
+            // Load mapping file
+            if (use_mapping) {
+                PhaseTimer timer(Phase::MappingLoad);
+                localToRealWorldMapping = loadMapping(map_path);
+                if (localToRealWorldMapping.empty()) {
+                    cerr << "Error opening mapping file: " << map_path << endl;
+                    return 1;
+                }
+            }
+
+            // Process all partitions sequentially
+            PhaseTimer timer(Phase::GraphParse);
+            if (streamed) {
+                loadGraph(graph_path, node_to_partition, subgraphs, use_mapping);
+            } else {
+                loadGraph(graph_path, part_path, subgraphs, use_mapping);
+            }
+        }
+
+        if (multiplex) {
+            int idx = gtypeIndex[gtype];
+            PhaseTimer timer(Phase::NeighborBuild);
+            layerGraphs[idx] = num_parts == 1 ? move(subgraphs[0]) : mergeSubgraphs(subgraphs);
+            layerMappings[idx] = move(localToRealWorldMapping);
+            continue;
+        }
+
+        // Give each partition the rows of its cut-edge endpoints so scores do
+        // not depend on how the graph was partitioned
+        {
+            PhaseTimer timer(Phase::NeighborBuild);
+            attachHalos(subgraphs);
+        }
+
+        // Relabel each partition (halo included) before it is compressed or scored
+        if (vertex_order != VertexOrder::None) {
+            PhaseTimer timer(Phase::NeighborBuild);
+            double miss_before = 0.0, miss_after = 0.0, reorder_seconds = 0.0;
+            int64_t edges = 0;
+            for (int part = 0; part < num_parts; ++part) {
+                int64_t part_edges = subgraphs[part].numEdges();
+                miss_before += estimateRowMissRate(subgraphs[part]) * part_edges;
+                auto reorder_start = chrono::steady_clock::now();
+                reorderGraph(subgraphs[part], vertex_order);
+                reorder_seconds += chrono::duration<double>(chrono::steady_clock::now() - reorder_start).count();
+                miss_after += estimateRowMissRate(subgraphs[part]) * part_edges;
+                edges += part_edges;
+            }
+            if (edges > 0) {
+                cout << "\nReorder for Graph: " << gtype << " -> " << vertexOrderName(vertex_order)
+                     << " in " << reorder_seconds << " s, estimated row miss rate "
+                     << 100.0 * miss_before / edges << "% -> " << 100.0 * miss_after / edges << "%" << endl;
             }
+        }
 
-            int local_id, real_id;
-            while (mapFile >> real_id >> local_id) {
-                localToRealWorldMapping[local_id] = real_id;
+        // Re-encode every partition and release its CSR
+        vector<CompressedGraph> packed(compressed ? num_parts : 0);
+        if (compressed) {
+            PhaseTimer timer(Phase::NeighborBuild);
+            size_t plain_bytes = 0, packed_bytes = 0;
+            int64_t edges = 0;
+            for (int part = 0; part < num_parts; ++part) {
+                plain_bytes += adjacencyBytes(subgraphs[part]);
+                edges += subgraphs[part].numEdges();
+                packed[part] = compressGraph(subgraphs[part]);
+                packed_bytes += packed[part].bytes();
+                subgraphs[part] = CSRGraph();
+            }
+            if (edges > 0) {
+                cout << "\nAdjacency for Graph: " << gtype << " -> compressed "
+                     << static_cast<double>(packed_bytes) / edges << " bytes/edge, plain "
+                     << static_cast<double>(plain_bytes) / edges << " bytes/edge" << endl;
             }
-            mapFile.close();
         }
 
-        // Process all partitions sequentially
-        vector<unordered_map<int, vector<Edge>>> subgraphs(NUM_PARTS);
-        loadGraph(graph_path, part_path, map_path, subgraphs, use_mapping);
+        // Each partition's top-K is selected in place; only these K-sized
+        // lists are merged, and the full score table only for the cache
+        unordered_map<int, double> mergedScores, candidates, exactCandidates;
+        ThreadStats layerStats;
+        double score_seconds = 0.0, exact_seconds = 0.0, place_seconds = 0.0;
+        vector<long long> layerComparisons(thread_node.size(), 0);
+        for (int part = 0; part < num_parts; ++part) {
+            // Move the partition's rows onto the nodes of the threads that read them
+            NumaReplicas replicas;
+            ScoreOptions partOptions = options;
+            if (numa != NumaMode::Off) {
+                PhaseTimer timer(Phase::NeighborBuild);
+                auto place_start = chrono::steady_clock::now();
+                if (numa == NumaMode::FirstTouch) {
+                    placeGraph(subgraphs[part]);
+                } else {
+                    replicas = replicateGraph(subgraphs[part], thread_node, topology.nodes());
+                    partOptions.replicas = &replicas;
+                }
+                place_seconds += chrono::duration<double>(chrono::steady_clock::now() - place_start).count();
+            }
+            vector<long long> comparisonsBefore = threadComparisons();
 
-        unordered_map<int, double> mergedScores;
-        for (int part = 0; part < NUM_PARTS; ++part) {
             const auto& local_subgraph = subgraphs[part];
-            auto scores = computeInfluenceScores(local_subgraph);
+            const vector<int>& vertex_ids = compressed ? packed[part].vertex_ids : local_subgraph.vertex_ids;
+            int num_local = compressed ? packed[part].num_local : local_subgraph.num_local;
+            ThreadStats partStats;
+            auto part_start = chrono::steady_clock::now();
+            vector<double> scores;
+            {
+                PhaseTimer timer(Phase::Scoring);
+                scores = compressed ? computeInfluenceScoresCompressed(packed[part], &partStats)
+                                    : computeInfluenceScores(local_subgraph, partOptions, &partStats);
+            }
+            score_seconds += chrono::duration<double>(chrono::steady_clock::now() - part_start).count();
+            vector<long long> comparisonsAfter = threadComparisons();
+            for (size_t t = 0; t < layerComparisons.size() && t < comparisonsAfter.size(); ++t) {
+                layerComparisons[t] += comparisonsAfter[t] - comparisonsBefore[t];
+            }
+            layerStats.busy_seconds.resize(partStats.busy_seconds.size(), 0.0);
+            for (size_t t = 0; t < partStats.busy_seconds.size(); ++t) {
+                layerStats.busy_seconds[t] += partStats.busy_seconds[t];
+            }
 
-            for (const auto& [node, score] : scores) {
-                int realNode = localToRealWorldMapping.count(node) ? 
-                              localToRealWorldMapping[node] : node;
-                mergedScores[realNode] = max(mergedScores[realNode], score);
+            auto realIdOf = [&](int v) { return realNodeId(localToRealWorldMapping, vertex_ids[v]); };
+            {
+                PhaseTimer timer(Phase::TopK);
+                for (const auto& [node, score] : selectTopK<K>(scores, top_k, realIdOf)) {
+                    candidates[node] = max(candidates[node], score);
+                }
+                if (!cache_path.empty()) {
+                    for (int v = 0; v < num_local; ++v) {
+                        double& best = mergedScores[realIdOf(v)];
+                        best = max(best, scores[v]);
+                    }
+                }
+            }
+
+            // Exact reference for the approximate run on the same partition
+            if (approximate) {
+                part_start = chrono::steady_clock::now();
+                vector<double> exact;
+                {
+                    PhaseTimer timer(Phase::Scoring);
+                    exact = computeInfluenceScores(local_subgraph, exact_options);
+                }
+                exact_seconds += chrono::duration<double>(chrono::steady_clock::now() - part_start).count();
+                for (const auto& [node, score] : selectTopK<K>(exact, top_k, realIdOf)) {
+                    exactCandidates[node] = max(exactCandidates[node], score);
+                }
             }
         }
 
-        auto globalTopK = getTopKInfluencers(mergedScores, K);
+        if (!cache_path.empty() && writeScoreCache(cache_path, cache_key, mergedScores)) {
+            cout << "\nScores for Graph: " << gtype << " cached in " << cache_path << endl;
+        }
 
-        cout << "\nGlobal Top-" << K << " Influencers for Graph: " << gtype << endl;
-        for (const auto& [node, score] : globalTopK) {
-            cout << "Node " << node << " -> Score: " << score << endl;
+        vector<pair<int, double>> globalTopK;
+        {
+            PhaseTimer timer(Phase::TopK);
+            globalTopK = getTopKInfluencers(candidates, top_k);
         }
 
-        // Update global allNodeScores map
-        int idx = gtypeIndex[gtype];
-        for (const auto& [node, score] : globalTopK) {
-            if (!allNodeScores.count(node)) {
-                allNodeScores[node] = vector<double>(4, 0.0);
-            }
-            allNodeScores[node][idx] = score;
+        if (approximate) {
+            const auto& approxTopK = globalTopK;
+            auto exactTopK = getTopKInfluencers(exactCandidates, top_k);
+            unordered_set<int> exactNodes;
+            for (const auto& [node, score] : exactTopK) exactNodes.insert(node);
+            int overlap = 0;
+            for (const auto& [node, score] : approxTopK) overlap += exactNodes.count(node);
+            cout << "\nTop-" << top_k << " overlap with exact for Graph: " << gtype << " -> "
+                 << overlap << "/" << exactTopK.size() << " (sketch " << options.sketch_size
+                 << ", minhash " << score_seconds << " s, exact " << exact_seconds << " s)" << endl;
         }
+
+        cout << "\nThread busy time for Graph: " << gtype << " (max/mean "
+             << layerStats.imbalance() << ")" << endl;
+        for (size_t t = 0; t < layerStats.busy_seconds.size(); ++t) {
+            cout << "Thread " << t << " -> " << layerStats.busy_seconds[t] << " s" << endl;
+        }
+        if (numa != NumaMode::Off) {
+            printNumaReport(gtype, numa, place_seconds, thread_node, topology.nodes(),
+                            layerStats.busy_seconds, layerComparisons);
+        }
+
+        reportLayer(gtype, globalTopK);
     }
 
     // Compute final weighted score
-    vector<double> weights = {0.3, 0.5, 0.4, 0.01}; // mention, retweet, reply, social
     vector<pair<int, double>> finalScores;
 
+    if (multiplex) {
+        // Every user's four layer scores are combined, not just the per-layer top-K
+        MultiplexGraph mx;
+        {
+            PhaseTimer timer(Phase::NeighborBuild);
+            mx = buildMultiplex(layerGraphs, layerMappings);
+            vector<CSRGraph>().swap(layerGraphs);
+        }
+        MultiplexScores mxScores;
+        {
+            PhaseTimer timer(Phase::Scoring);
+            mxScores = computeMultiplexScores(mx, weights, options);
+        }
+
+        PhaseTimer timer(Phase::TopK);
+        for (size_t l = 0; l < graph_types.size(); ++l) {
+            if (mx.layers[l].numEdges() == 0) continue;
+            cout << "\nGlobal Top-" << top_k << " Influencers for Graph: " << graph_types[l] << endl;
+            for (const auto& [node, score] : getTopKInfluencers<K>(mx.layers[l], mxScores.layers[l], top_k)) {
+                cout << "Node " << node << " -> Score: " << score << endl;
+            }
+        }
+        if (mx.numVertices() > 0) {
+            finalScores = getTopKInfluencers<K>(mx.layers[0], mxScores.combined, top_k);
+        }
+    }
+
     for (const auto& [node, vec] : allNodeScores) {
         double overall = 0.0;
         for (int i = 0; i < 4; ++i) {
@@ -97,21 +524,32 @@ int main() {
         finalScores.emplace_back(node, overall);
     }
 
-    sort(finalScores.begin(), finalScores.end(), [](const auto& a, const auto& b) {
-        return a.second > b.second;
-    });
+    {
+        PhaseTimer timer(Phase::TopK);
+        sort(finalScores.begin(), finalScores.end(), rankedBefore);
+    }
 
     auto end_time = chrono::high_resolution_clock::now();
     auto duration = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
 
-    cout << "\n========== FINAL GLOBAL TOP-" << K << " INFLUENCERS ==========\n";
-    for (int i = 0; i < min(K, (int)finalScores.size()); ++i) {
+    cout << "\n========== FINAL GLOBAL TOP-" << top_k << " INFLUENCERS ==========\n";
+    for (int i = 0; i < min(top_k, (int)finalScores.size()); ++i) {
         int node = finalScores[i].first;
         double score = finalScores[i].second;
         cout << "Node " << node << " -> Overall Score: " << score << endl;
     }
 
+    const IngestStats& ingest = ingestStats();
+    if (ingest.bytes > 0) {
+        cout << "\nText ingest: " << ingest.bytes / 1e6 << " MB in " << ingest.seconds
+             << " s (" << ingest.megabytesPerSecond() << " MB/s)" << endl;
+    }
+
     cout << "\nTotal execution time: " << duration.count() / 1000.0 << " seconds" << endl;
 
+    if (PROFILE_ENABLED && writeProfileJson(profile_path, "serial_influence", {profile().pack()})) {
+        cout << "Profile written to " << profile_path << endl;
+    }
+
     return 0;
 }
\ No newline at end of file
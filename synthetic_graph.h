@@ -0,0 +1,185 @@
+#ifndef SYNTHETIC_GRAPH_H
+#define SYNTHETIC_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <charconv>
+#include <tuple>
+
+#include "load_graph.h"
+
+using namespace std;
+
+// Random graphs with a Higgs-like heavy-tailed degree distribution, written
+// in the same METIS + .part.N layout as the real layers so every loader and
+// kernel runs on them unchanged.
+enum class GraphModel { RMat, ChungLu };
+
+struct SyntheticOptions {
+    GraphModel model = GraphModel::RMat;
+    int scale = 16;             // 2^scale vertices
+    int edge_factor = 16;       // sampled edges per vertex
+    double a = 0.57, b = 0.19, c = 0.19;  // R-MAT quadrant probabilities
+    double exponent = 2.1;      // Chung-Lu degree exponent
+    unsigned seed = 1;
+};
+
+// Undirected graph as sorted rows of METIS IDs (1-based in the file, 0-based
+// here). Repeated samples of an edge add up to its weight, like repeated
+// interactions between two users; self-loops are dropped.
+struct SyntheticGraph {
+    int num_nodes = 0;
+    vector<int64_t> offsets;
+    vector<int> neighbors;
+    vector<int> weights;
+
+    int64_t numEdges() const { return static_cast<int64_t>(neighbors.size()); }
+};
+
+GraphModel parseGraphModel(const string& name) {
+    if (name == "chunglu") return GraphModel::ChungLu;
+    if (name != "rmat") cerr << "Warning: Unknown graph model '" << name << "', using rmat" << endl;
+    return GraphModel::RMat;
+}
+
+namespace synthetic_detail {
+
+// Fixed number of sampling blocks, each with its own generator, so the graph
+// only depends on the seed and not on the thread count
+const int SAMPLE_BLOCKS = 256;
+
+// One R-MAT edge: each level picks a quadrant of the adjacency matrix
+inline pair<int, int> rmatEdge(mt19937_64& rng, const SyntheticOptions& opt) {
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    int u = 0, v = 0;
+    for (int level = 0; level < opt.scale; ++level) {
+        double r = unit(rng);
+        int bit_u = r >= opt.a + opt.b ? 1 : 0;
+        int bit_v = (r >= opt.a && r < opt.a + opt.b) || r >= opt.a + opt.b + opt.c ? 1 : 0;
+        u = (u << 1) | bit_u;
+        v = (v << 1) | bit_v;
+    }
+    return {u, v};
+}
+
+}
+
+// Samples num_nodes * edge_factor edges from the chosen model and folds them
+// into sorted, symmetric rows.
+SyntheticGraph generateSyntheticGraph(const SyntheticOptions& opt) {
+    using namespace synthetic_detail;
+    SyntheticGraph g;
+    int n = 1 << opt.scale;
+    int64_t samples = static_cast<int64_t>(n) * opt.edge_factor;
+    g.num_nodes = n;
+
+    // Chung-Lu: vertex i has expected degree proportional to (i + 1)^(-1/(exponent - 1));
+    // endpoints are drawn by inverting the cumulative weight
+    vector<double> cumulative;
+    if (opt.model == GraphModel::ChungLu) {
+        cumulative.resize(n);
+        double alpha = 1.0 / (opt.exponent - 1.0), total = 0.0;
+        for (int i = 0; i < n; ++i) {
+            total += pow(i + 1.0, -alpha);
+            cumulative[i] = total;
+        }
+    }
+
+    vector<pair<int, int>> edges(samples);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int block = 0; block < SAMPLE_BLOCKS; ++block) {
+        mt19937_64 rng(opt.seed * 1000003ULL + block);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        int64_t first = samples * block / SAMPLE_BLOCKS;
+        int64_t last = samples * (block + 1) / SAMPLE_BLOCKS;
+        for (int64_t e = first; e < last; ++e) {
+            int u, v;
+            if (opt.model == GraphModel::RMat) {
+                tie(u, v) = rmatEdge(rng, opt);
+            } else {
+                double total = cumulative.back();
+                u = static_cast<int>(lower_bound(cumulative.begin(), cumulative.end(), unit(rng) * total) - cumulative.begin());
+                v = static_cast<int>(lower_bound(cumulative.begin(), cumulative.end(), unit(rng) * total) - cumulative.begin());
+                u = min(u, n - 1);
+                v = min(v, n - 1);
+            }
+            edges[e] = {min(u, v), max(u, v)};
+        }
+    }
+
+    // Both directions of every non-loop sample, then runs of equal pairs
+    // collapse into one weighted edge
+    vector<pair<int, int>> directed;
+    directed.reserve(edges.size() * 2);
+    for (const auto& [u, v] : edges) {
+        if (u == v) continue;
+        directed.push_back({u, v});
+        directed.push_back({v, u});
+    }
+    vector<pair<int, int>>().swap(edges);
+    sort(directed.begin(), directed.end());
+
+    g.offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < directed.size();) {
+        size_t j = i;
+        while (j < directed.size() && directed[j] == directed[i]) j++;
+        g.neighbors.push_back(directed[i].second);
+        g.weights.push_back(static_cast<int>(j - i));
+        g.offsets[directed[i].first + 1]++;
+        i = j;
+    }
+    for (int v = 0; v < n; ++v) g.offsets[v + 1] += g.offsets[v];
+    return g;
+}
+
+// Writes the METIS .graph file: "<nodes> <edges> [1]", then one line of
+// 1-based neighbors (with weights if `weighted`) per node.
+bool writeMetisGraph(const string& path, const SyntheticGraph& g, bool weighted) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        cerr << "Error: Cannot write graph file: " << path << endl;
+        return false;
+    }
+    out << g.num_nodes << " " << g.numEdges() / 2 << (weighted ? " 1" : "") << "\n";
+
+    string line;
+    char buf[16];
+    for (int v = 0; v < g.num_nodes; ++v) {
+        line.clear();
+        for (int64_t e = g.offsets[v]; e < g.offsets[v + 1]; ++e) {
+            if (e > g.offsets[v]) line += ' ';
+            line.append(buf, to_chars(buf, buf + sizeof(buf), g.neighbors[e] + 1).ptr);
+            if (weighted) {
+                line += ' ';
+                line.append(buf, to_chars(buf, buf + sizeof(buf), g.weights[e]).ptr);
+            }
+        }
+        line += '\n';
+        out << line;
+    }
+    return static_cast<bool>(out);
+}
+
+// Stands in for gpmetis: contiguous ID ranges holding about the same number
+// of edges each. The hubs of both models sit at low IDs, so this keeps the
+// partitions balanced by work rather than by vertex count.
+bool writePartitionFile(const string& path, const SyntheticGraph& g, int num_parts) {
+    ofstream out(path);
+    if (!out) {
+        cerr << "Error: Cannot write partition file: " << path << endl;
+        return false;
+    }
+    int64_t total = g.numEdges();
+    for (int v = 0; v < g.num_nodes; ++v) {
+        int64_t before = g.offsets[v];
+        int part = total > 0 ? static_cast<int>(before * num_parts / total) : 0;
+        out << min(part, num_parts - 1) << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+#endif
@@ -0,0 +1,146 @@
+// g++ -std=c++17 -O2 -o test_intersection test_intersection.cpp
+// ./test_intersection [--seed S]
+//
+// Checks every intersection kernel the CPU can run, and intersectionCount()
+// itself, against a set-based count on random ascending lists. Covers empty
+// lists, lists shorter than one vector, every tail remainder of the 4/8/16-wide
+// kernels and degree skew around GALLOP_RATIO in both argument orders.
+// Exits with status 1 on the first mismatch.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <unordered_set>
+#include <algorithm>
+#include <iterator>
+#include <cstdlib>
+#include "Intersection.h"
+
+using namespace std;
+
+struct NamedKernel {
+    const char* name;
+    IntersectKernel kernel;
+};
+
+// Kernels runnable on this CPU; the dispatcher is checked separately.
+vector<NamedKernel> availableKernels() {
+    vector<NamedKernel> kernels = {{"scalar", intersectScalar}, {"gallop", intersectGallop}};
+#ifdef INTERSECT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) kernels.push_back({"sse4.2", intersectSSE});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", intersectAVX2});
+    if (__builtin_cpu_supports("avx512f")) kernels.push_back({"avx512", intersectAVX512});
+#endif
+    kernels.push_back({"intersectionCount", intersectionCount});
+    return kernels;
+}
+
+// n distinct ascending values drawn from [0, range)
+vector<int> randomList(mt19937& rng, int n, int range) {
+    range = max(range, n);
+    unordered_set<int> picked;
+    uniform_int_distribution<int> pick(0, range - 1);
+    while (static_cast<int>(picked.size()) < n) picked.insert(pick(rng));
+    vector<int> list(picked.begin(), picked.end());
+    sort(list.begin(), list.end());
+    return list;
+}
+
+// Reference count, the way the original scoring loop did it
+int setCount(const vector<int>& a, const vector<int>& b) {
+    unordered_set<int> in_a(a.begin(), a.end());
+    int count = 0;
+    for (int x : b) {
+        if (in_a.count(x)) count++;
+    }
+    return count;
+}
+
+long long checks = 0;
+
+// Runs every kernel on (a, b) and (b, a); exits on the first disagreement.
+void checkPair(const vector<NamedKernel>& kernels, const vector<int>& a, const vector<int>& b,
+               const string& label) {
+    int expected = setCount(a, b);
+    for (const NamedKernel& k : kernels) {
+        int ab = k.kernel(a.data(), static_cast<int>(a.size()), b.data(), static_cast<int>(b.size()));
+        int ba = k.kernel(b.data(), static_cast<int>(b.size()), a.data(), static_cast<int>(a.size()));
+        checks += 2;
+        if (ab != expected || ba != expected) {
+            cerr << "Error: " << k.name << " on " << label << " (|a|=" << a.size()
+                 << ", |b|=" << b.size() << ") returned " << ab << " / " << ba
+                 << ", expected " << expected << endl;
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = 42;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(stoul(argv[++i]));
+        } else {
+            cerr << "Usage: " << argv[0] << " [--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    mt19937 rng(seed);
+    vector<NamedKernel> kernels = availableKernels();
+    cout << "Kernels:";
+    for (const NamedKernel& k : kernels) cout << " " << k.name;
+    cout << " (dispatch: " << intersectKernelName() << ")" << endl;
+
+    // Empty lists
+    vector<int> empty, some = randomList(rng, 37, 100);
+    checkPair(kernels, empty, empty, "empty/empty");
+    checkPair(kernels, empty, some, "empty/list");
+
+    // Every length pair up to a few AVX-512 blocks, so each kernel sees lists
+    // shorter than one vector and every tail remainder. The value range sets
+    // the overlap: dense (mostly shared), sparse and disjoint.
+    const int max_len = 50;
+    for (int na = 0; na <= max_len; na++) {
+        for (int nb = 0; nb <= max_len; nb++) {
+            int range = 2 * max(na, nb) + 1;
+            checkPair(kernels, randomList(rng, na, range), randomList(rng, nb, range), "dense");
+            checkPair(kernels, randomList(rng, na, 20 * range), randomList(rng, nb, 20 * range), "sparse");
+
+            vector<int> low = randomList(rng, na, range), high = randomList(rng, nb, range);
+            for (int& x : high) x += range;
+            checkPair(kernels, low, high, "disjoint");
+        }
+        vector<int> same = randomList(rng, na, 3 * na + 1);
+        checkPair(kernels, same, same, "identical");
+    }
+
+    // Skew around the galloping threshold: just below, at and above it
+    for (int ns : {1, 2, 3, 7, 16, 33}) {
+        for (int ratio : {GALLOP_RATIO - 1, GALLOP_RATIO, GALLOP_RATIO + 1, 2 * GALLOP_RATIO, 100 * GALLOP_RATIO}) {
+            for (int extra : {0, 1, ns - 1}) {
+                int nl = ns * ratio + extra;
+                checkPair(kernels, randomList(rng, ns, 2 * nl), randomList(rng, nl, 2 * nl), "skewed");
+
+                // The short list drawn from the long one, so every element matches
+                vector<int> longer = randomList(rng, nl, 2 * nl), shorter;
+                sample(longer.begin(), longer.end(), back_inserter(shorter), ns, rng);
+                checkPair(kernels, shorter, longer, "skewed subset");
+            }
+        }
+    }
+
+    // Larger random pairs with mixed lengths
+    uniform_int_distribution<int> len(0, 3000);
+    for (int t = 0; t < 2000; t++) {
+        int na = len(rng), nb = len(rng);
+        int range = max(na, nb) * (1 + t % 8);
+        checkPair(kernels, randomList(rng, na, range), randomList(rng, nb, range), "random");
+    }
+
+    cout << "All " << checks << " kernel results matched the set-based count." << endl;
+    return 0;
+}
@@ -0,0 +1,225 @@
+// g++ -std=c++17 -O2 -fopenmp -o update_influence update_influence.cpp
+// ./update_influence [--parts N] [--random N] [--seed S]
+// ./update_influence --self-test ROUNDS [--random N] [--seed S]
+//
+// Applies a batch of edge changes to every layer and patches the influence
+// scores and top-K in place instead of recomputing them. The batch for a
+// layer is read from updates/higgs-<layer>_network.updates ("+ u v [w]" to
+// insert, "- u v" to delete, real-world IDs); without that file a random
+// batch of --random changes is generated. The incremental result is checked
+// against a full recompute and both latencies are reported.
+//
+// --self-test needs no Higgs files: it grows a small heavy-tailed layer
+// through applyEdgeBatch and then applies ROUNDS random batches of --random
+// changes, checking every batch against a full recompute.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <cstdlib>
+#include "load_graph.h"
+#include "binary_graph.h"
+#include "Influence.h"
+#include "Top-k.h"
+#include "incremental.h"
+
+using namespace std;
+
+const int K = 10;
+
+// Half deletes of existing edges; the inserts alternate between two
+// existing users and an existing user (or the previous newcomer) and a
+// brand-new ID above every current one.
+vector<EdgeUpdate> randomEdgeUpdates(const DynamicGraph& g, int count, unsigned seed) {
+    vector<EdgeUpdate> batch;
+    int n = g.numVertices();
+    if (n == 0) return batch;
+    mt19937 rng(seed);
+    uniform_int_distribution<int> pick(0, n - 1);
+    int next_id = *max_element(g.vertex_ids.begin(), g.vertex_ids.end()) + 1;
+    int first_new = next_id;
+    for (int i = 0; i < count; ++i) {
+        int u = pick(rng);
+        if (i % 2 == 0 && !g.rows[u].empty()) {
+            int v = g.rows[u][rng() % g.rows[u].size()];
+            batch.push_back({false, g.vertex_ids[u], g.vertex_ids[v], 0});
+        } else if (i % 4 == 3) {
+            int other = (i % 8 == 7 && next_id > first_new) ? next_id - 1 : g.vertex_ids[u];
+            batch.push_back({true, next_id++, other, 1});
+        } else {
+            batch.push_back({true, g.vertex_ids[u], g.vertex_ids[pick(rng)], 1});
+        }
+    }
+    return batch;
+}
+
+// Checks the patched graph against a full recompute on a copy and against
+// the regular kernel on a CSR copy.
+bool matchesFullRecompute(const DynamicGraph& graph) {
+    DynamicGraph full = graph;
+    rescoreAll(full);
+    vector<double> kernel = computeInfluenceScores(toCSR(graph), KernelSchedule::Dynamic);
+    return graph.scores == full.scores && graph.row_jaccard == full.row_jaccard &&
+           graph.topK == full.topK && graph.scores == kernel;
+}
+
+// Starts from an empty layer, so every vertex enters through applyEdgeBatch.
+// Endpoints are skewed towards low IDs to produce hubs, and IDs are spread
+// out so index_of has gaps. Then runs `rounds` random batches.
+bool runSelfTest(int rounds, int batch_size, unsigned seed) {
+    const int users = 3000, edges = 30000;
+    mt19937 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    auto skewed = [&]() { return 3 * static_cast<int>(users * pow(unit(rng), 3.0)); };
+
+    DynamicGraph graph;
+    graph.k = K;
+    vector<EdgeUpdate> initial;
+    for (int e = 0; e < edges; ++e) {
+        initial.push_back({true, skewed(), skewed(), 1 + static_cast<int>(rng() % 3)});
+    }
+    applyEdgeBatch(graph, initial);
+    bool ok = matchesFullRecompute(graph);
+    cout << "Initial batch: " << graph.numVertices() << " vertices, matches full recompute: "
+         << (ok ? "yes" : "no") << endl;
+
+    int full_topk = 0;
+    for (int r = 0; r < rounds && ok; ++r) {
+        int before = graph.numVertices();
+        vector<EdgeUpdate> batch = randomEdgeUpdates(graph, batch_size, seed + 1 + r);
+
+        // Odd rounds stay away from the top-K members and their neighbors, so
+        // no member can drop and the top-K is patched instead of rescanned
+        if (r % 2 == 1) {
+            vector<char> near_top(graph.index_of.size(), 0);
+            for (const auto& member : graph.topK) {
+                int v = graph.index_of[member.first];
+                near_top[member.first] = 1;
+                for (int x : graph.rows[v]) near_top[graph.vertex_ids[x]] = 1;
+            }
+            auto near = [&](int id) { return id < static_cast<int>(near_top.size()) && near_top[id]; };
+            batch.erase(remove_if(batch.begin(), batch.end(),
+                                  [&](const EdgeUpdate& up) { return near(up.u) || near(up.v); }),
+                        batch.end());
+        }
+
+        UpdateStats stats = applyEdgeBatch(graph, batch);
+        full_topk += stats.full_topk;
+        if (!matchesFullRecompute(graph)) {
+            cerr << "Error: Batch " << r << " (" << graph.numVertices() - before
+                 << " new vertices) does not match the full recompute" << endl;
+            ok = false;
+        }
+    }
+    if (ok) {
+        cout << rounds << " batches of up to " << batch_size << " updates matched the full recompute ("
+             << graph.numVertices() << " vertices at the end, top-K rescanned " << full_topk
+             << " times)" << endl;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int num_parts = NUM_PARTS;
+    int random_count = 1000;
+    unsigned seed = 1;
+    int self_test_rounds = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--parts" && i + 1 < argc) {
+            num_parts = atoi(argv[++i]);
+        } else if (arg == "--random" && i + 1 < argc) {
+            random_count = atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (arg == "--self-test" && i + 1 < argc) {
+            self_test_rounds = atoi(argv[++i]);
+        } else {
+            cerr << "Usage: " << argv[0] << " [--parts N] [--random N] [--seed S] [--self-test ROUNDS]" << endl;
+            return 1;
+        }
+    }
+    if (num_parts < 1) {
+        cerr << "--parts must be at least 1" << endl;
+        return 1;
+    }
+    if (self_test_rounds > 0) {
+        return runSelfTest(self_test_rounds, random_count, seed) ? 0 : 1;
+    }
+
+    bool all_match = true;
+    for (const auto& gtype : graph_types) {
+        string base = "higgs-" + gtype + "_network";
+        string graph_path = "graphs/" + base + ".graph";
+        string part_path = "gparts/" + base + ".graph.part." + to_string(num_parts);
+        string map_path = "gparts/" + base + ".graph.mapping.txt";
+        string update_path = "updates/" + base + ".updates";
+        bool use_mapping = (gtype != "social");
+
+        string bin_path = binaryGraphPath(graph_path, num_parts);
+        bool have_text = filesystem::exists(graph_path) && filesystem::exists(part_path) &&
+                         (!use_mapping || filesystem::exists(map_path));
+
+        vector<CSRGraph> subgraphs(num_parts);
+        vector<int> mapping;
+        if (!loadBinaryGraph(bin_path, graph_path, part_path, use_mapping ? map_path : "",
+                             subgraphs, mapping)) {
+            if (!have_text) {
+                cerr << "Missing file(s) for graph type: " << gtype << endl;
+                continue;
+            }
+            if (use_mapping) {
+                mapping = loadMapping(map_path);
+                if (mapping.empty()) {
+                    cerr << "Error opening mapping file: " << map_path << endl;
+                    return 1;
+                }
+            }
+            loadGraph(graph_path, part_path, subgraphs, use_mapping);
+        }
+
+        CSRGraph whole = num_parts == 1 ? move(subgraphs[0]) : mergeSubgraphs(subgraphs);
+        vector<CSRGraph>().swap(subgraphs);
+        DynamicGraph graph = buildDynamicGraph(whole, mapping, K);
+        whole = CSRGraph();
+
+        vector<EdgeUpdate> batch = filesystem::exists(update_path)
+                                       ? loadEdgeUpdates(update_path)
+                                       : randomEdgeUpdates(graph, random_count, seed);
+
+        auto start = chrono::steady_clock::now();
+        UpdateStats stats = applyEdgeBatch(graph, batch);
+        double incremental_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        // Reference: every Jaccard and score recomputed on the updated graph
+        vector<double> patched = graph.scores;
+        vector<pair<int, double>> patchedTopK = graph.topK;
+        start = chrono::steady_clock::now();
+        rescoreAll(graph);
+        double full_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        // And the regular kernel on a CSR copy of the updated graph
+        vector<double> kernel = computeInfluenceScores(toCSR(graph), KernelSchedule::Dynamic);
+        bool match = patched == graph.scores && patched == kernel && patchedTopK == graph.topK;
+        all_match = all_match && match;
+
+        cout << "\nBatch of " << batch.size() << " updates for Graph: " << gtype << endl;
+        cout << "Changed vertices: " << stats.changed << ", rescored: " << stats.rescored
+             << ", Jaccards recomputed: " << stats.jaccards
+             << (stats.full_topk ? ", top-K rescanned" : "") << endl;
+        cout << "Incremental: " << incremental_seconds << " s, full recompute: " << full_seconds
+             << " s, matches full recompute: " << (match ? "yes" : "no") << endl;
+
+        cout << "\nGlobal Top-" << K << " Influencers for Graph: " << gtype << endl;
+        for (const auto& [node, score] : patchedTopK) {
+            cout << "Node " << node << " -> Score: " << score << endl;
+        }
+    }
+
+    return all_match ? 0 : 1;
+}